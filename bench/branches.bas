@@ -0,0 +1,10 @@
+10 REM Statement-heavy lines: IF/ELSE chains, GOTO and GOSUB
+20 C=0:D=0:E=0
+30 N=0
+40 N=N+1:IF N/3=INT(N/3) THEN C=C+1: ELSE D=D+1
+50 IF N/5=INT(N/5) THEN GOSUB 200
+60 IF N<60000 THEN 40
+70 PRINT C;D;E
+80 END
+200 E=E+1:A$="X":IF E>100 THEN A$="Y"
+210 RETURN
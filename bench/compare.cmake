@@ -0,0 +1,58 @@
+# Runs every bench/*.bas program under both statement dispatch modes and
+# reports the gain of threaded dispatch over the portable switch.
+#
+#   cmake -DTHREADED=<kbasic-bench> -DSWITCH=<kbasic-bench-switch>
+#         -DPROGRAM_DIR=<dir> -P compare.cmake
+
+file(GLOB programs ${PROGRAM_DIR}/*.bas)
+list(SORT programs)
+
+function(run_bench exe prefix)
+    execute_process(
+        COMMAND ${exe} ${programs}
+        OUTPUT_VARIABLE output
+        RESULT_VARIABLE result
+    )
+    if (NOT result EQUAL 0)
+        message(FATAL_ERROR "${exe} failed:\n${output}")
+    endif()
+
+    string(REPLACE "\n" ";" lines "${output}")
+    foreach (line ${lines})
+        if (line MATCHES "^# (.*): (.*)$")
+            get_filename_component(name "${CMAKE_MATCH_1}" NAME)
+            set(${prefix}_out_${name} "${CMAKE_MATCH_2}" PARENT_SCOPE)
+        elseif (line MATCHES "^(.+) ([0-9]+)$")
+            get_filename_component(name "${CMAKE_MATCH_1}" NAME)
+            set(${prefix}_${name} ${CMAKE_MATCH_2} PARENT_SCOPE)
+        endif()
+    endforeach()
+endfunction()
+
+run_bench(${SWITCH} switch)
+run_bench(${THREADED} threaded)
+
+message("program            switch (us)  threaded (us)  gain")
+foreach (program ${programs})
+    get_filename_component(name ${program} NAME)
+    set(s ${switch_${name}})
+    set(t ${threaded_${name}})
+    if (s GREATER 0)
+        math(EXPR gain "(${s} - ${t}) * 100 / ${s}")
+    else()
+        set(gain 0)
+    endif()
+
+    string(LENGTH "${name}" length)
+    set(spaces " ")
+    if (length LESS 18)
+        foreach (i RANGE ${length} 17)
+            string(APPEND spaces " ")
+        endforeach()
+    endif()
+    message("${name}${spaces}${s}         ${t}          ${gain}%")
+
+    if (NOT "${switch_out_${name}}" STREQUAL "${threaded_out_${name}}")
+        message(WARNING "${name}: output differs between dispatch modes")
+    endif()
+endforeach()
@@ -0,0 +1,9 @@
+10 REM Arithmetic inside nested FOR loops
+20 S=0:X=0.5
+30 FOR I=1 TO 600
+40 FOR J=1 TO 100
+50 S=S+I*2-J/4+X*3:T=I*J:U=-T+2^2
+60 IF S>100000 THEN S=S-100000
+70 NEXT J
+80 NEXT I
+90 PRINT S;T;U
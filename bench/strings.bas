@@ -0,0 +1,19 @@
+10 REM String building, arrays and READ
+20 DIM A$(100)
+30 FOR K=1 TO 120
+40 RESTORE
+50 FOR I=1 TO 100:READ W$:A$(I)=W$+STR$(I):NEXT I
+60 S$="":FOR I=1 TO 100:IF A$(I)<>"" THEN S$=A$(I)
+70 NEXT I
+80 NEXT K
+90 PRINT S$
+100 DATA "alpha","beta","gamma","delta","epsilon","zeta","eta","theta","iota","kappa"
+110 DATA "alpha","beta","gamma","delta","epsilon","zeta","eta","theta","iota","kappa"
+120 DATA "alpha","beta","gamma","delta","epsilon","zeta","eta","theta","iota","kappa"
+130 DATA "alpha","beta","gamma","delta","epsilon","zeta","eta","theta","iota","kappa"
+140 DATA "alpha","beta","gamma","delta","epsilon","zeta","eta","theta","iota","kappa"
+150 DATA "alpha","beta","gamma","delta","epsilon","zeta","eta","theta","iota","kappa"
+160 DATA "alpha","beta","gamma","delta","epsilon","zeta","eta","theta","iota","kappa"
+170 DATA "alpha","beta","gamma","delta","epsilon","zeta","eta","theta","iota","kappa"
+180 DATA "alpha","beta","gamma","delta","epsilon","zeta","eta","theta","iota","kappa"
+190 DATA "alpha","beta","gamma","delta","epsilon","zeta","eta","theta","iota","kappa"
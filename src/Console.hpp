@@ -20,6 +20,8 @@ struct CursorPos {
 
 class Console {
 public:
+    virtual ~Console() {}
+
     virtual void addText(string s, PrintAppendMode appendMode = pam_none) = 0;
     virtual void putTextAt(int location, string s, PrintAppendMode appendMode = pam_none) = 0;
     virtual void clearText() = 0;
@@ -30,6 +32,10 @@ public:
     virtual int lineSize() = 0;
     virtual int lineCount() = 0;
     virtual string getKey() = 0;
+
+    // The next key, waiting up to timeout milliseconds for one where the
+    // console can; "" if none came
+    virtual string waitForKey(int timeout) { (void)timeout; return getKey(); }
     virtual CursorPos getCursorPos() = 0;
     virtual void setCursorPos(const CursorPos &pos) = 0;
 };
@@ -0,0 +1,38 @@
+#ifndef _COUNTERS_HPP_
+#define _COUNTERS_HPP_
+
+#include "main.hpp"
+
+#include <cstdint>
+
+/*
+ * Counters for STAT that are bumped outside System: Value, the file
+ * readers and writers and the window.  Some of them are bumped from other
+ * threads - MAT INPUT's parsers, the ASYNC writer, the UI thread - so they
+ * are atomics, always updated with relaxed ordering; nothing is ordered by
+ * them, they only have to add up.  The interpreter's own counters are in
+ * System::m_counters.
+ */
+struct Counters {
+    atomic<uint64_t> stringValues{0};   // Values made holding a string
+    atomic<uint64_t> bytesRead{0};      // By INPUT#, MAT INPUT# and GET#
+    atomic<uint64_t> bytesWritten{0};   // By PRINT# and PUT#
+    atomic<uint64_t> frames{0};         // Frames the window has presented
+
+    void reset()
+    {
+        stringValues.store(0, memory_order_relaxed);
+        bytesRead.store(0, memory_order_relaxed);
+        bytesWritten.store(0, memory_order_relaxed);
+        frames.store(0, memory_order_relaxed);
+    }
+};
+
+inline Counters counters;
+
+inline void tally(atomic<uint64_t> &counter, uint64_t n = 1)
+{
+    counter.fetch_add(n, memory_order_relaxed);
+}
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef _DEVICE_HPP_
+#define _DEVICE_HPP_
+
+#include "main.hpp"
+
+#include <algorithm>
+
+#include <unistd.h>
+
+/*
+ * The reserved names OPEN maps to the process's own streams, so a program
+ * can read a pipe with INPUT# and write one with PRINT#.  The descriptor
+ * for a device name, or -1 for an ordinary file; the names are matched
+ * without regard to case.
+ */
+inline int deviceDescriptor(const string &name)
+{
+    string lname = name;
+    transform(lname.begin(), lname.end(), lname.begin(), [](unsigned char c){ return toupper(c); });
+
+    if (lname == "STDIN:") return STDIN_FILENO;
+    if (lname == "STDOUT:") return STDOUT_FILENO;
+    if (lname == "STDERR:") return STDERR_FILENO;
+    return -1;
+}
+
+#endif
@@ -0,0 +1,236 @@
+#include "FieldReader.hpp"
+#include "Counters.hpp"
+#include "Device.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <iterator>
+#include <thread>
+#include <cerrno>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+FieldReader::FieldReader(const string &filename)
+{
+    int device = deviceDescriptor(filename);
+    m_device = (device >= 0);
+    if (device == STDIN_FILENO) m_fd = device;
+    else if (!m_device) m_fd = ::open(filename.c_str(), O_RDONLY);
+    if (m_fd >= 0) m_buffer.reset(new char[BUFFER_SIZE]);
+}
+
+FieldReader::~FieldReader()
+{
+    close();
+}
+
+void FieldReader::close()
+{
+    if (m_fd >= 0 && !m_device) ::close(m_fd);
+    m_fd = -1;
+    m_pos = m_end = 0;
+}
+
+bool FieldReader::fill()
+{
+    if (m_fd < 0) return false;
+
+    ssize_t count;
+    do
+    {
+        count = ::read(m_fd, m_buffer.get(), BUFFER_SIZE);
+    } while (count < 0 && errno == EINTR);
+
+    m_pos = 0;
+    m_end = (count > 0 ? size_t(count) : 0);
+    tally(counters.bytesRead, m_end);
+    return m_end > 0;
+}
+
+bool FieldReader::eof()
+{
+    return (m_pos >= m_end && !fill());
+}
+
+inline bool isDelimiter(char c)
+{
+    return (c == ',' || c == ':' || c == ';' || c == '\n');
+}
+
+bool FieldReader::next(string &field)
+{
+    field.clear();
+    if (eof()) return false;
+
+    while (true)
+    {
+        const char *start = m_buffer.get() + m_pos;
+        const char *end = m_buffer.get() + m_end;
+        const char *p = start;
+        while (p < end && !isDelimiter(*p)) p++;
+
+        field.append(start, p - start);
+        m_pos += p - start;
+        if (p < end)
+        {
+            m_pos++;
+            break;
+        }
+
+        // The field runs on into the next block, or to the end of the file
+        if (!fill()) break;
+    }
+
+    if (field.find('\r') != string::npos)
+    {
+        string s;
+        s.reserve(field.size());
+        for (char c : field)
+        {
+            if (c != '\r') s += c;
+        }
+        field.swap(s);
+    }
+
+    return true;
+}
+
+string FieldReader::rest()
+{
+    string result;
+    do
+    {
+        result.append(m_buffer.get() + m_pos, m_end - m_pos);
+        m_pos = m_end;
+    } while (fill());
+
+    return result;
+}
+
+Value FieldReader::number(const string &field)
+{
+    return number(field.data(), field.data() + field.size());
+}
+
+Value FieldReader::number(const char *first, const char *last)
+{
+    while (first < last && (*first == ' ' || *first == '\t')) first++;
+    while (last > first && (last[-1] == ' ' || last[-1] == '\t')) last--;
+    if (first < last && *first == '+') first++;
+    if (first == last) return Value();
+
+    int i;
+    from_chars_result r = from_chars(first, last, i);
+    if (r.ec == errc() && r.ptr == last) return Value(i);
+
+#ifdef __cpp_lib_to_chars
+    float f;
+    r = from_chars(first, last, f);
+    if (r.ec == errc() && r.ptr == last) return Value(f);
+#else
+    // Older standard libraries only have the integer from_chars
+    string s(first, last);
+    char *end = nullptr;
+    float f = strtof(s.c_str(), &end);
+    if (end == s.c_str() + s.size()) return Value(f);
+#endif
+
+    return Value();
+}
+
+static string withoutReturns(const char *first, const char *last)
+{
+    string s;
+    s.reserve(last - first);
+    for (const char *p = first; p < last; p++)
+    {
+        if (*p != '\r') s += *p;
+    }
+    return s;
+}
+
+bool FieldReader::parseChunk(const char *first, const char *last, bool lastChunk, bool strings,
+    vector<Value> &values, string &bad)
+{
+    const char *start = first;
+    for (const char *p = first; p <= last; p++)
+    {
+        // Every chunk but the last ends just after a delimiter; at the end of
+        // the data, trailing text after the last delimiter is a field too
+        if (p < last && !isDelimiter(*p)) continue;
+        if (p == last && (!lastChunk || p == start)) break;
+
+        const char *end = p;
+        if (find(start, end, '\r') != end)
+        {
+            string s = withoutReturns(start, end);
+            values.push_back(strings ? Value(s) : number(s));
+        } else
+        {
+            values.push_back(strings ? Value(string(start, end)) : number(start, end));
+        }
+
+        if (values.back().isNull())
+        {
+            bad = string(start, end);
+            return false;
+        }
+        start = p + 1;
+    }
+
+    return true;
+}
+
+bool FieldReader::parseAll(const string &data, bool strings, vector<Value> &values, string &bad)
+{
+    const char *first = data.data();
+    const char *last = first + data.size();
+
+    size_t threads = max(1u, thread::hardware_concurrency());
+    size_t chunks = min(threads, data.size() / MIN_CHUNK + 1);
+
+    // Chunk boundaries fall just after a delimiter, so no field is split
+    vector<const char *> bounds(1, first);
+    for (size_t i = 1; i < chunks; i++)
+    {
+        const char *p = max(bounds.back(), first + data.size() * i / chunks);
+        while (p < last && !isDelimiter(*p)) p++;
+        if (p < last) bounds.push_back(p + 1);
+    }
+    bounds.push_back(last);
+
+    size_t count = bounds.size() - 1;
+    vector<vector<Value>> results(count);
+    vector<string> errors(count);
+    vector<char> ok(count, true);
+    vector<thread> workers;
+    for (size_t i = 1; i < count; i++)
+    {
+        workers.push_back(thread([&, i]() {
+            ok[i] = parseChunk(bounds[i], bounds[i + 1], i == count - 1, strings, results[i], errors[i]);
+        }));
+    }
+    ok[0] = parseChunk(bounds[0], bounds[1], count == 1, strings, results[0], errors[0]);
+    for (thread &worker : workers) worker.join();
+
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!ok[i])
+        {
+            bad = errors[i];
+            return false;
+        }
+        total += results[i].size();
+    }
+
+    values.clear();
+    values.reserve(total);
+    for (size_t i = 0; i < count; i++)
+    {
+        move(results[i].begin(), results[i].end(), back_inserter(values));
+    }
+    return true;
+}
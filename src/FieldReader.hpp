@@ -0,0 +1,57 @@
+#ifndef _FIELDREADER_HPP_
+#define _FIELDREADER_HPP_
+
+#include "Value.hpp"
+
+#include <memory>
+#include <vector>
+
+/*
+ * Reads INPUT# fields from a file a large block at a time.  A field ends at
+ * ',', ':', ';' or a newline, and carriage returns are dropped, as they
+ * always have been; unlike the old character-at-a-time reader it knows
+ * where the file ends, which EOF() reports.  Opening "STDIN:" reads the
+ * program's standard input, which close() leaves open.
+ */
+class FieldReader {
+public:
+    FieldReader(const string &filename);
+    ~FieldReader();
+
+    bool isOpen() const { return m_fd >= 0; }
+    bool eof();
+    bool next(string &field);
+    void close();
+
+    // Bytes of buffer held, for MEM
+    size_t memoryUsed() const { return (m_buffer ? BUFFER_SIZE : 0); }
+
+    // Everything from the current position to the end of the file
+    string rest();
+
+    // The field as an integer or real, or a null Value if it isn't a number
+    static Value number(const string &field);
+    static Value number(const char *first, const char *last);
+
+    // Splits data into fields exactly as next() would and converts them to
+    // strings or numbers.  Large inputs are cut into chunks at delimiters
+    // and parsed on several threads.  False, with the field in bad, if a
+    // field should have been a number and isn't.
+    static bool parseAll(const string &data, bool strings, vector<Value> &values, string &bad);
+
+private:
+    static const size_t BUFFER_SIZE = 1 << 20;
+    static const size_t MIN_CHUNK = 1 << 20;
+
+    int m_fd = -1;
+    bool m_device = false;          // Standard input; not ours to close
+    unique_ptr<char[]> m_buffer;    // Uninitialised; small files touch little of it
+    size_t m_pos = 0;
+    size_t m_end = 0;
+
+    bool fill();
+    static bool parseChunk(const char *first, const char *last, bool lastChunk, bool strings,
+        vector<Value> &values, string &bad);
+};
+
+#endif
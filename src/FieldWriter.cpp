@@ -0,0 +1,191 @@
+#include "FieldWriter.hpp"
+#include "Counters.hpp"
+#include "Device.hpp"
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+FieldWriter::FieldWriter(const string &filename, int flushInterval, bool async)
+{
+    int device = deviceDescriptor(filename);
+    m_device = (device >= 0);
+    if (device == STDOUT_FILENO || device == STDERR_FILENO) m_fd = device;
+    else if (!m_device) m_fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    setFlushInterval(flushInterval);
+    m_lastFlush = chrono::steady_clock::now();
+    if (m_fd < 0) return;
+
+    m_block = new Block();
+    m_blocks = 1;
+    m_async = async;
+    if (m_async) m_thread = thread(&FieldWriter::writerLoop, this);
+}
+
+FieldWriter::~FieldWriter()
+{
+    close();
+}
+
+bool FieldWriter::close()
+{
+    if (m_fd < 0) return !m_failed;
+
+    submit();
+    if (m_async)
+    {
+        {
+            lock_guard<mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_one();
+        m_thread.join();
+
+        Block *block;
+        while (m_free.pop(block)) delete block;
+    }
+    delete m_block;
+    m_block = nullptr;
+
+    if (!m_device) ::close(m_fd);
+    m_fd = -1;
+    return !m_failed;
+}
+
+bool FieldWriter::writeAll(const char *data, size_t size)
+{
+    while (size > 0 && !m_failed)
+    {
+        ssize_t count = ::write(m_fd, data, size);
+        if (count < 0)
+        {
+            if (errno != EINTR) m_failed = true;
+            continue;
+        }
+        data += count;
+        size -= count;
+        tally(counters.bytesWritten, count);
+    }
+
+    return !m_failed;
+}
+
+// The I/O thread: writes blocks in the order they were queued and hands
+// them back.  After a failure the data is dropped but blocks still return.
+void FieldWriter::writerLoop()
+{
+#ifdef KBASIC_FIELDWRITER_TEST
+    while (holdIoThreads) this_thread::sleep_for(chrono::milliseconds(1));
+#endif
+
+    while (true)
+    {
+        Block *block;
+        if (m_full.pop(block))
+        {
+            writeAll(block->data.get(), block->used);
+            block->used = 0;
+
+            // There are never more blocks than m_free holds
+            m_free.push(block);
+            {
+                lock_guard<mutex> lock(m_mutex);
+                m_pending--;
+            }
+            m_done.notify_one();
+            continue;
+        }
+
+        // submit() queues under the lock, so the check and the wait can't
+        // miss its wakeup
+        unique_lock<mutex> lock(m_mutex);
+        if (m_stop && m_full.empty()) break;
+        m_wake.wait(lock, [this]() { return m_stop || !m_full.empty(); });
+    }
+}
+
+FieldWriter::Block *FieldWriter::freeBlock()
+{
+    Block *block;
+    if (m_free.pop(block)) return block;
+    if (m_blocks < QUEUE_SIZE)
+    {
+        m_blocks++;
+        return new Block();
+    }
+
+    // Every block is queued: the program has got ahead of the disk
+    unique_lock<mutex> lock(m_mutex);
+    m_done.wait(lock, [this, &block]() { return m_free.pop(block); });
+    return block;
+}
+
+// Writes out the current block, or queues it for the I/O thread
+bool FieldWriter::submit()
+{
+    m_lastFlush = chrono::steady_clock::now();
+    if (m_block->used == 0) return !m_failed;
+
+    if (!m_async)
+    {
+        writeAll(m_block->data.get(), m_block->used);
+        m_block->used = 0;
+        return !m_failed;
+    }
+
+    {
+        // With no more blocks than m_full holds there's always room, but
+        // a block is never dropped: wait for the I/O thread to take one
+        unique_lock<mutex> lock(m_mutex);
+        m_done.wait(lock, [this]() { return m_full.push(m_block); });
+        m_pending++;
+    }
+    m_wake.notify_one();
+    m_block = freeBlock();
+    return !m_failed;
+}
+
+bool FieldWriter::flush()
+{
+    if (m_fd < 0) return !m_failed;
+
+    submit();
+    if (m_async)
+    {
+        unique_lock<mutex> lock(m_mutex);
+        m_done.wait(lock, [this]() { return m_pending == 0; });
+    }
+    return !m_failed;
+}
+
+bool FieldWriter::write(const string &s)
+{
+    if (m_fd < 0 || m_failed) return false;
+
+    if (m_block->used + s.size() > BUFFER_SIZE)
+    {
+        if (!submit()) return false;
+
+        // Too big to be worth copying into a buffer
+        if (s.size() > BUFFER_SIZE)
+        {
+            if (m_async) flush();
+            return writeAll(s.data(), s.size());
+        }
+    }
+
+    memcpy(m_block->data.get() + m_block->used, s.data(), s.size());
+    m_block->used += s.size();
+
+    return timedFlush();
+}
+
+bool FieldWriter::timedFlush(bool force)
+{
+    if (m_fd < 0 || m_flushInterval.count() == 0) return !m_failed;
+    if (!force && chrono::steady_clock::now() - m_lastFlush < m_flushInterval) return !m_failed;
+
+    return submit();
+}
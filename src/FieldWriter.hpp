@@ -0,0 +1,100 @@
+#ifndef _FIELDWRITER_HPP_
+#define _FIELDWRITER_HPP_
+
+#include "main.hpp"
+#include "SpscQueue.hpp"
+
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/*
+ * Collects PRINT# output in a large buffer and hands it to the file in
+ * big writes.  The buffer is written out when it fills, when the file is
+ * flushed or closed, and - if a flush interval is set - by timedFlush()
+ * once the interval has passed since the last flush, so a long-running
+ * program's output doesn't sit in memory indefinitely.  write() makes
+ * that check itself; the interpreter makes it between lines, and forces
+ * it before waiting for the user, for programs that have stopped writing.
+ *
+ * An asynchronous writer (OPEN ... ASYNC) passes full buffers to its own
+ * I/O thread instead of writing them itself, so a slow disk only holds up
+ * the program once all QUEUE_SIZE of its buffers are waiting; it then
+ * sleeps until the thread hands one back.  A failed write is picked up by
+ * the next call that touches the file.
+ *
+ * "STDOUT:" and "STDERR:" write to the program's own streams through the
+ * same buffers; close() flushes them but leaves the descriptor open.
+ */
+class FieldWriter {
+public:
+    FieldWriter(const string &filename, int flushInterval = 0, bool async = false);
+    ~FieldWriter();
+
+    bool isOpen() const { return m_fd >= 0; }
+    bool isAsync() const { return m_async; }
+
+    // All three return false once a write to the file has failed; flush()
+    // and close() wait for an asynchronous writer to finish
+    bool write(const string &s);
+    bool flush();
+    bool close();
+
+    // Milliseconds between timed flushes; 0 flushes only when full or asked
+    void setFlushInterval(int ms) { m_flushInterval = chrono::milliseconds(ms); }
+
+    // Writes the buffer out if there's a flush interval and it has passed,
+    // or with force whenever there's an interval; doesn't wait for an
+    // asynchronous writer
+    bool timedFlush(bool force = false);
+
+    // Bytes of buffers held, for MEM
+    size_t memoryUsed() const { return m_blocks * BUFFER_SIZE; }
+
+#ifdef KBASIC_FIELDWRITER_TEST
+    // Keeps I/O threads from taking anything off their queues while set
+    static inline atomic<bool> holdIoThreads{false};
+#endif
+
+private:
+    static const size_t BUFFER_SIZE = 1 << 20;
+    static const size_t QUEUE_SIZE = 8;
+
+    // Left uninitialised, so a file that writes little only costs the
+    // pages it touches
+    struct Block {
+        unique_ptr<char[]> data;
+        size_t used = 0;
+
+        Block() : data(new char[BUFFER_SIZE]) {}
+    };
+
+    int m_fd = -1;
+    bool m_device = false;
+    atomic<bool> m_failed{false};
+    Block *m_block = nullptr;
+    chrono::milliseconds m_flushInterval;
+    chrono::steady_clock::time_point m_lastFlush;
+
+    bool m_async = false;
+    thread m_thread;
+    SpscQueue<Block *, QUEUE_SIZE> m_full;      // Waiting for the I/O thread
+    SpscQueue<Block *, QUEUE_SIZE> m_free;      // Written, ready for reuse
+    size_t m_blocks = 0;                        // Never more than QUEUE_SIZE
+
+    // The queues don't block; the threads sleep on these instead
+    mutex m_mutex;
+    condition_variable m_wake;                  // A block queued, or stop
+    condition_variable m_done;                  // A block written
+    int m_pending = 0;                          // Queued and not yet written
+    bool m_stop = false;
+
+    bool writeAll(const char *data, size_t size);
+    bool submit();
+    Block *freeBlock();
+    void writerLoop();
+};
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef _FILETABLE_HPP_
+#define _FILETABLE_HPP_
+
+#include "FieldReader.hpp"
+#include "FieldWriter.hpp"
+#include "RecordFile.hpp"
+
+#include <memory>
+
+enum AccessMode { am_input, am_output, am_random };
+
+inline string accessName(AccessMode accessMode)
+{
+    if (accessMode == am_input) return "INPUT";
+    if (accessMode == am_output) return "OUTPUT";
+    return "RANDOM";
+}
+
+const int DEFAULT_RECORD_LENGTH = 128;
+
+// An open file; exactly one of reader, writer and records is set, by access mode
+struct FileAccess {
+    int number;
+    unique_ptr<FieldReader> reader;
+    unique_ptr<FieldWriter> writer;
+    unique_ptr<RecordFile> records;
+    vector<string> fields;      // The FIELD variables of a RANDOM file
+    int matCount = 0;           // Elements read by the last MAT INPUT, for NUM()
+    AccessMode accessMode;
+    string filename;
+    bool m_open = false;
+    bool failureReported = false;   // So flushFiles() doesn't repeat it
+
+    inline bool isOpen() const { return m_open; }
+
+    size_t memoryUsed() const
+    {
+        size_t result = sizeof(FileAccess) + filename.capacity() + fields.capacity() * sizeof(string);
+        if (reader) result += sizeof(FieldReader) + reader->memoryUsed();
+        if (writer) result += sizeof(FieldWriter) + writer->memoryUsed();
+        if (records) result += sizeof(RecordFile) + records->memoryUsed();
+        return result;
+    }
+
+    FileAccess(string name, int number, AccessMode accessMode, int flushInterval = 0,
+        int recordLength = DEFAULT_RECORD_LENGTH, bool async = false)
+    {
+        this->filename = name;
+        this->number = number;
+        this->accessMode = accessMode;
+        if (accessMode == am_input) 
+        {
+            reader.reset(new FieldReader(name));
+            m_open = reader->isOpen();
+        }
+        if (accessMode == am_output) 
+        {
+            writer.reset(new FieldWriter(name, flushInterval, async));
+            m_open = writer->isOpen();
+        }
+        if (accessMode == am_random)
+        {
+            records.reset(new RecordFile(name, recordLength));
+            m_open = records->isOpen();
+        }
+    }
+};
+
+/*
+ * The open files, in a fixed table indexed directly by file number, so
+ * every PRINT#, INPUT# or GET is a bounds check and an array load.  The
+ * table owns its files; erasing one closes it.
+ */
+class FileTable {
+public:
+    static const int CAPACITY = 512;
+
+    // File numbers run from 1 to CAPACITY - 1
+    static bool inRange(int number) { return number >= 1 && number < CAPACITY; }
+
+    FileAccess *find(int number) const
+    {
+        return (inRange(number) ? m_files[number].get() : nullptr);
+    }
+
+    void insert(unique_ptr<FileAccess> f)
+    {
+        int number = f->number;
+        m_files[number] = move(f);
+        if (number > m_highest) m_highest = number;
+    }
+
+    void erase(int number)
+    {
+        if (inRange(number)) m_files[number].reset();
+    }
+
+    // Calls f(FileAccess *) for each open file in file number order
+    template <typename F>
+    void forEach(F f) const
+    {
+        for (int i = 1; i <= m_highest; i++)
+        {
+            if (m_files[i]) f(m_files[i].get());
+        }
+    }
+
+private:
+    unique_ptr<FileAccess> m_files[CAPACITY];
+    int m_highest = 0;
+};
+
+#endif
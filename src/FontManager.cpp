@@ -11,6 +11,11 @@
  
 #include <iostream>
 
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
 FontManager *fontManager = new FontManager();
 
 void FontManager::initialize() {
@@ -22,6 +27,43 @@ void FontManager::initialize() {
     for (int i = 0; i < static_cast<int>(fontFileNames.size()); i++) {
         fontFamiliesArray.push_back(new FontMap());
     }
+    fontFiles.resize(fontFileNames.size());
+}
+
+void FontManager::cleanup() {
+    for (FontMap *fontMap : fontFamiliesArray) {
+        for (auto &f : *fontMap) {
+            TTF_CloseFont(f.second);
+        }
+        delete fontMap;
+    }
+    fontFamiliesArray.clear();
+
+    for (FontFile &file : fontFiles) {
+        if (file.data) munmap(const_cast<void *>(file.data), file.size);
+        file = FontFile();
+    }
+}
+
+const FontFile *FontManager::mapFontFile(int fontFamily) {
+    FontFile &file = fontFiles[fontFamily];
+    if (file.data) return &file;
+
+    std::string resPath = resourcePath + fontFileNames[fontFamily];
+    int fd = open(resPath.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            file.data = data;
+            file.size = st.st_size;
+        }
+    }
+    close(fd);
+
+    return (file.data ? &file : nullptr);
 }
 
 TTF_Font *FontManager::getFont(int fontFamily, int fontSize) {
@@ -32,8 +74,9 @@ TTF_Font *FontManager::getFont(int fontFamily, int fontSize) {
     FontMap *fontMap = fontFamiliesArray[fontFamily];
     auto f = fontMap->find(fontSize);
     if (f == fontMap->end()) {
-        std::string resPath = resourcePath + fontFileNames[fontFamily];
-        TTF_Font *font = TTF_OpenFont(resPath.c_str(), fontSize);
+        const FontFile *file = mapFontFile(fontFamily);
+        TTF_Font *font = nullptr;
+        if (file) font = TTF_OpenFontRW(SDL_RWFromConstMem(file->data, static_cast<int>(file->size)), 1, fontSize);
         if (font == nullptr){
             throw "TTF_OpenFont:getFont";
         }
@@ -46,3 +89,20 @@ TTF_Font *FontManager::getFont(int fontFamily, int fontSize) {
     return result;
 }
 
+SDL_Point FontManager::cellSize(int fontFamily, int fontSize) {
+    std::pair<int, int> key(fontFamily, fontSize);
+    auto c = cellSizes.find(key);
+    if (c != cellSizes.end()) return c->second;
+
+    TTF_Font *font = getFont(fontFamily, fontSize);
+    SDL_Point size = {0, 0};
+    if (font) {
+        int advance = 0;
+        TTF_GlyphMetrics(font, 'g', nullptr, nullptr, nullptr, nullptr, &advance);
+        size.x = advance;
+        size.y = TTF_FontHeight(font);
+    }
+
+    cellSizes[key] = size;
+    return size;
+}
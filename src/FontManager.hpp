@@ -25,11 +25,29 @@
 
 typedef std::map<int, TTF_Font *> FontMap;
 
+// A font file mapped into memory, shared by every size opened from it
+struct FontFile {
+    const void *data = nullptr;
+    size_t size = 0;
+};
+
+/*
+ * Fonts are opened only when first asked for, one face and size at a
+ * time.  Each file is memory-mapped once rather than read through a
+ * stream per size, and the cell size of each face and size is worked out
+ * from its metrics once instead of by rendering a probe glyph.
+ */
 class FontManager {
 private:
     std::vector<FontMap *> fontFamiliesArray;
     
     std::vector<std::string> fontFileNames;
+
+    std::vector<FontFile> fontFiles;
+
+    std::map<std::pair<int, int>, SDL_Point> cellSizes;
+
+    const FontFile *mapFontFile(int fontFamily);
     
 public:
     static const int SOURCECODEPRO = 0;
@@ -40,6 +58,9 @@ public:
     void cleanup();
     
     TTF_Font *getFont(int fontFamily, int fontSize);
+
+    // The width and height of one character of a monospaced font
+    SDL_Point cellSize(int fontFamily, int fontSize);
 };
 
 extern FontManager *fontManager;
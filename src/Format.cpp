@@ -0,0 +1,90 @@
+#include "main.hpp"
+
+#include <sstream>
+#include <iomanip>
+#include <locale>
+#include <algorithm>
+#include <climits>
+
+bool isFloat( string myString ) {
+    std::istringstream iss(myString);
+    float f;
+    iss >> noskipws >> f; // noskipws considers leading whitespace invalid
+    // Check the entire string was consumed and if either failbit or badbit is set
+    return iss.eof() && !iss.fail(); 
+}
+
+bool isInteger(string s)
+{
+    bool result = true;
+    for (char const &c : s)
+    {
+        if (!isdigit(c))
+        {
+            result = false;
+            break;
+        }
+    }
+    return result;
+}
+
+void rtrim(string &s) {
+    s.erase(find_if(s.rbegin(), s.rend(), [](int ch) {
+        return !isspace(ch);
+    }).base(), s.end());
+}
+
+string formatString(string s, string format)
+{
+    class comma_numpunct : public std::numpunct<char>
+    {
+        public:
+            comma_numpunct(bool grouping)
+            {
+                this->m_grouping = grouping;
+            }
+
+        protected:
+            bool m_grouping = false;
+
+            virtual char do_thousands_sep() const
+            {
+                return ',';
+            }
+
+            virtual std::string do_grouping() const
+            {
+                return (m_grouping ? "\03" : "");
+            }
+    };
+
+    if (format == "") return s;
+    if (!isInteger(s) && !isFloat(s)) return s;
+
+    float num = stof(s, NULL);
+
+    int dotLoc = format.find('.');
+    int commaLoc = format.find(",");
+    bool dollarSign = format.at(0) == '$';
+
+    string fa = (dotLoc > -1 ? format.substr(0, dotLoc) : format);
+    string fb = (dotLoc > -1 ? format.substr(dotLoc + 1, INT_MAX) : "");
+    
+    size_t firstSize = std::count(fa.begin(), fa.end(), '#');
+    size_t lastSize = std::count(fb.begin(), fb.end(), '#');
+
+    stringstream ss;
+    locale comma_locale(locale(), new comma_numpunct((commaLoc < dotLoc) || (commaLoc > -1 && dotLoc == -1)));
+
+    // tell cout to use our new locale.
+    ss.imbue(comma_locale);
+
+    ss << setprecision(lastSize) << fixed << num;
+
+    string result = ss.str();
+    if (dollarSign) result = "$" + result;
+    dotLoc = result.find('.');
+    if (dotLoc > -1 && firstSize > static_cast<size_t>(dotLoc)) result = string(firstSize - dotLoc, ' ') + result;
+
+    return result;
+}
@@ -0,0 +1,46 @@
+#include "GlyphAtlas.hpp"
+
+#include <algorithm>
+
+GlyphAtlas::GlyphAtlas(SDL_Renderer *renderer, TTF_Font *font, int cellWidth, int cellHeight)
+{
+    m_cellWidth = cellWidth;
+    m_cellHeight = cellHeight;
+
+    int rows = (GLYPH_COUNT + COLUMNS - 1) / COLUMNS;
+    SDL_Surface *atlas = SDL_CreateRGBSurfaceWithFormat(0, COLUMNS * m_cellWidth, rows * m_cellHeight, 32, SDL_PIXELFORMAT_RGBA8888);
+    if (!atlas) return;
+
+    for (int i = 0; i < GLYPH_COUNT; i++)
+    {
+        SDL_Surface *glyph = TTF_RenderGlyph_Blended(font, Uint16(FIRST_GLYPH + i), {255, 255, 255, 255});
+        if (!glyph) continue;
+
+        // Copy the glyph's alpha as it is rather than blending it onto the
+        // empty atlas, and keep anything that overhangs out of the next cell
+        SDL_SetSurfaceBlendMode(glyph, SDL_BLENDMODE_NONE);
+        SDL_Rect src = {0, 0, std::min(glyph->w, m_cellWidth), std::min(glyph->h, m_cellHeight)};
+        SDL_Rect dst = {(i % COLUMNS) * m_cellWidth, (i / COLUMNS) * m_cellHeight, src.w, src.h};
+        SDL_BlitSurface(glyph, &src, atlas, &dst);
+        SDL_FreeSurface(glyph);
+    }
+
+    m_texture = SDL_CreateTextureFromSurface(renderer, atlas);
+    SDL_FreeSurface(atlas);
+    if (m_texture) SDL_SetTextureBlendMode(m_texture, SDL_BLENDMODE_BLEND);
+}
+
+GlyphAtlas::~GlyphAtlas()
+{
+    if (m_texture) SDL_DestroyTexture(m_texture);
+}
+
+void GlyphAtlas::draw(SDL_Renderer *renderer, unsigned char c, int x, int y) const
+{
+    if (c < FIRST_GLYPH || !m_texture) return;
+
+    int i = c - FIRST_GLYPH;
+    SDL_Rect src = {(i % COLUMNS) * m_cellWidth, (i / COLUMNS) * m_cellHeight, m_cellWidth, m_cellHeight};
+    SDL_Rect dst = {x, y, m_cellWidth, m_cellHeight};
+    SDL_RenderCopy(renderer, m_texture, &src, &dst);
+}
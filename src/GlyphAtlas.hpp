@@ -0,0 +1,36 @@
+#ifndef _GLYPHATLAS_HPP_
+#define _GLYPHATLAS_HPP_
+
+#include <SDL2/SDL.h>
+#include <SDL_ttf.h>
+
+/*
+ * Every character of a monospaced font rasterized once into a single
+ * texture, a fixed-size cell apiece, so a screen of text is drawn by
+ * copying cells instead of running each line through SDL_ttf.  Covers
+ * the Latin-1 range that TTF_RenderText draws; control characters draw
+ * nothing.
+ */
+class GlyphAtlas {
+public:
+    GlyphAtlas(SDL_Renderer *renderer, TTF_Font *font, int cellWidth, int cellHeight);
+    ~GlyphAtlas();
+
+    bool isValid() const { return m_texture != nullptr; }
+    int cellWidth() const { return m_cellWidth; }
+    int cellHeight() const { return m_cellHeight; }
+
+    // Copies the glyph for c to the renderer's current target at x, y
+    void draw(SDL_Renderer *renderer, unsigned char c, int x, int y) const;
+
+private:
+    static const int FIRST_GLYPH = 32;
+    static const int GLYPH_COUNT = 256 - FIRST_GLYPH;
+    static const int COLUMNS = 16;
+
+    SDL_Texture *m_texture = nullptr;
+    int m_cellWidth;
+    int m_cellHeight;
+};
+
+#endif
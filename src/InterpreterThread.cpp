@@ -0,0 +1,266 @@
+#include "InterpreterThread.hpp"
+#include "System.hpp"
+
+#include <chrono>
+#include <sstream>
+
+InterpreterThread::InterpreterThread(int lineSize, int lineCount)
+{
+    m_lineSize = lineSize;
+    m_lineCount = lineCount;
+}
+
+InterpreterThread::~InterpreterThread()
+{
+    stop();
+}
+
+void InterpreterThread::start()
+{
+    m_thread = thread(&InterpreterThread::run, this);
+}
+
+// Whatever is running has to notice loopResult first; after this, output
+// is dropped and anything waiting on the window gives up
+void InterpreterThread::stop()
+{
+    m_stopping = true;
+    {
+        lock_guard<mutex> lock(m_lineMutex);
+    }
+    m_lineReady.notify_one();
+    {
+        lock_guard<mutex> lock(m_replyMutex);
+    }
+    m_replyReady.notify_one();
+    wake();
+
+    if (m_thread.joinable()) m_thread.join();
+}
+
+bool InterpreterThread::submit(const string &line)
+{
+    lock_guard<mutex> lock(m_lineMutex);
+    if (m_busy) return false;
+
+    m_line = line;
+    m_hasLine = true;
+    m_busy = true;
+    m_lineReady.notify_one();
+    return true;
+}
+
+void InterpreterThread::run()
+{
+    while (true)
+    {
+        string line;
+        {
+            unique_lock<mutex> lock(m_lineMutex);
+            m_lineReady.wait(lock, [this]() { return m_hasLine || m_stopping; });
+            if (m_stopping) break;
+
+            line = m_line;
+            m_hasLine = false;
+        }
+
+        // Keys meant for the last program aren't for this one
+        string key;
+        while (m_keys.pop(key));
+
+        core->command(line, this);
+
+        ConsoleCommand done;
+        done.op = co_done;
+        send(done);
+        m_busy = false;
+    }
+}
+
+// Waits for the window to catch up if the queue is full
+void InterpreterThread::send(const ConsoleCommand &command)
+{
+    while (!m_commands.push(command))
+    {
+        if (m_stopping) return;
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+}
+
+void InterpreterThread::reply(const ConsoleReply &reply)
+{
+    m_replies.push(reply);
+    {
+        lock_guard<mutex> lock(m_replyMutex);
+    }
+    m_replyReady.notify_one();
+}
+
+ConsoleReply InterpreterThread::waitForReply()
+{
+    ConsoleReply reply;
+    unique_lock<mutex> lock(m_replyMutex);
+    m_replyReady.wait(lock, [this]() { return !m_replies.empty() || m_stopping; });
+    if (!m_replies.pop(reply)) reply.escaped = true;
+    return reply;
+}
+
+void InterpreterThread::pushKey(const string &key)
+{
+    if (!m_keys.push(key)) return;
+    wake();
+}
+
+// Lets a GETKEY that is waiting see a key, a break or a quit
+void InterpreterThread::wake()
+{
+    {
+        lock_guard<mutex> lock(m_keyMutex);
+    }
+    m_keyReady.notify_one();
+}
+
+void InterpreterThread::addText(string s, PrintAppendMode appendMode)
+{
+    ConsoleCommand command;
+    command.op = co_addText;
+    command.text = move(s);
+    command.appendMode = appendMode;
+    send(command);
+}
+
+void InterpreterThread::putTextAt(int location, string s, PrintAppendMode appendMode)
+{
+    ConsoleCommand command;
+    command.op = co_putTextAt;
+    command.text = move(s);
+    command.appendMode = appendMode;
+    command.col = location;
+    send(command);
+}
+
+void InterpreterThread::clearText()
+{
+    ConsoleCommand command;
+    command.op = co_clearText;
+    send(command);
+}
+
+void InterpreterThread::terminate()
+{
+    ConsoleCommand command;
+    command.op = co_terminate;
+    send(command);
+}
+
+bool InterpreterThread::loop()
+{
+    return loopResult;
+}
+
+float InterpreterThread::inputNumber(string prompt)
+{
+    ConsoleCommand command;
+    command.op = co_input;
+    command.text = move(prompt);
+    command.number = true;
+    send(command);
+
+    // The window only accepts a valid number or nothing
+    ConsoleReply reply = waitForReply();
+    if (reply.escaped || reply.text == "") return 0.0;
+    return stof(reply.text);
+}
+
+string InterpreterThread::inputString(string prompt)
+{
+    ConsoleCommand command;
+    command.op = co_input;
+    command.text = move(prompt);
+    send(command);
+
+    ConsoleReply reply = waitForReply();
+    return (reply.escaped ? "" : reply.text);
+}
+
+string InterpreterThread::getKey()
+{
+    string key;
+    m_keys.pop(key);
+    return key;
+}
+
+string InterpreterThread::waitForKey(int timeout)
+{
+    unique_lock<mutex> lock(m_keyMutex);
+    m_keyReady.wait_for(lock, chrono::milliseconds(timeout), [this]() {
+        return !m_keys.empty() || m_stopping || loopResult == l_escape || loopResult == l_quitting;
+    });
+
+    string key;
+    m_keys.pop(key);
+    return key;
+}
+
+CursorPos InterpreterThread::getCursorPos()
+{
+    ConsoleCommand command;
+    command.op = co_getCursorPos;
+    send(command);
+
+    ConsoleReply reply = waitForReply();
+    return CursorPos(reply.col, reply.row);
+}
+
+void InterpreterThread::setCursorPos(const CursorPos &pos)
+{
+    ConsoleCommand command;
+    command.op = co_setCursorPos;
+    command.col = pos.col;
+    command.row = pos.row;
+    send(command);
+}
+
+string toRecord(const ConsoleCommand &command)
+{
+    switch (command.op)
+    {
+        case co_addText: return "a " + to_string(command.appendMode) + " " + command.text;
+        case co_putTextAt: return "p " + to_string(command.col) + " " + to_string(command.appendMode) + " " + command.text;
+        case co_clearText: return "c";
+        case co_setCursorPos: return "s " + to_string(command.col) + " " + to_string(command.row);
+        default: return "";
+    }
+}
+
+bool fromRecord(const string &record, ConsoleCommand &command)
+{
+    istringstream in(record);
+    char op = 0;
+    int mode = 0;
+    in >> op;
+
+    command = ConsoleCommand();
+    if (op == 'a') command.op = co_addText;
+    else if (op == 'p') command.op = co_putTextAt;
+    else if (op == 'c') command.op = co_clearText;
+    else if (op == 's') command.op = co_setCursorPos;
+    else return false;
+
+    if (command.op == co_putTextAt) in >> command.col;
+    if (command.op == co_setCursorPos) in >> command.col >> command.row;
+    if (command.op == co_addText || command.op == co_putTextAt) in >> mode;
+    if (in.fail() || mode < pam_none || mode > pam_tab) return false;
+
+    if (command.op == co_addText || command.op == co_putTextAt)
+    {
+        command.appendMode = PrintAppendMode(mode);
+
+        // Exactly one space separates the mode from text that may
+        // itself start with spaces
+        in.get();
+        getline(in, command.text);
+    }
+
+    return true;
+}
@@ -0,0 +1,115 @@
+#ifndef _INTERPRETERTHREAD_HPP_
+#define _INTERPRETERTHREAD_HPP_
+
+#include "Console.hpp"
+#include "SpscQueue.hpp"
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+enum ConsoleOp { co_addText, co_putTextAt, co_clearText, co_setCursorPos, co_getCursorPos, co_input, co_terminate, co_done };
+
+// A console operation on its way from the interpreter to the window
+struct ConsoleCommand {
+    ConsoleOp op = co_addText;
+    string text;
+    PrintAppendMode appendMode = pam_none;
+    int col = 0;            // co_putTextAt's location goes here too
+    int row = 0;
+    bool number = false;    // co_input wants a number
+};
+
+// Screen output as one line of text, for recording a session and
+// replaying it in kbasic-render-bench:
+//
+//     a <append mode> <text>              addText
+//     p <location> <append mode> <text>   putTextAt
+//     c                                   clearText
+//     s <col> <row>                       setCursorPos
+//
+// Other operations have no record; toRecord returns "" for them.
+string toRecord(const ConsoleCommand &command);
+bool fromRecord(const string &record, ConsoleCommand &command);
+
+// The window's answer to co_getCursorPos or co_input
+struct ConsoleReply {
+    string text;
+    int col = 0;
+    int row = 0;
+    bool escaped = false;
+};
+
+/*
+ * Runs System on a thread of its own, so the program and the window no
+ * longer take turns.  System sees this as its Console: output is queued
+ * for the window to apply on the UI thread, and the calls that need an
+ * answer (the cursor position, INPUT) wait for the window's reply.  The
+ * queues are lock-free; the mutexes are only there to let an idle thread
+ * sleep.
+ */
+class InterpreterThread : public Console {
+public:
+    InterpreterThread(int lineSize, int lineCount);
+    ~InterpreterThread();
+
+    // Called from the UI thread
+    void start();
+    void stop();
+    bool submit(const string &line);    // False while the last line is still running
+    bool busy() const { return m_busy; }
+    bool pending() const { return !m_commands.empty(); }   // Output not yet received
+    bool receive(ConsoleCommand &command) { return m_commands.pop(command); }
+    void reply(const ConsoleReply &reply);
+    void pushKey(const string &key);
+    void wake();
+
+    // Console, called by System on the interpreter thread
+    void addText(string s, PrintAppendMode appendMode = pam_none);
+    void putTextAt(int location, string s, PrintAppendMode appendMode = pam_none);
+    void clearText();
+    void terminate();
+    bool loop();
+    float inputNumber(string prompt);
+    string inputString(string prompt);
+    int lineSize() { return m_lineSize; }
+    int lineCount() { return m_lineCount; }
+    string getKey();
+    string waitForKey(int timeout);
+    CursorPos getCursorPos();
+    void setCursorPos(const CursorPos &pos);
+
+private:
+    static const size_t COMMAND_QUEUE_SIZE = 4096;
+    static const size_t KEY_QUEUE_SIZE = 64;
+
+    int m_lineSize;
+    int m_lineCount;
+
+    thread m_thread;
+    atomic<bool> m_busy{false};
+    atomic<bool> m_stopping{false};
+
+    mutex m_lineMutex;
+    condition_variable m_lineReady;
+    string m_line;
+    bool m_hasLine = false;
+
+    SpscQueue<ConsoleCommand, COMMAND_QUEUE_SIZE> m_commands;
+    SpscQueue<ConsoleReply, 4> m_replies;
+    mutex m_replyMutex;
+    condition_variable m_replyReady;
+
+    // Keys pressed while a program runs, for GETKEY and INKEY$; when the
+    // program doesn't keep up, the newest are dropped
+    SpscQueue<string, KEY_QUEUE_SIZE> m_keys;
+    mutex m_keyMutex;
+    condition_variable m_keyReady;
+
+    void run();
+    void send(const ConsoleCommand &command);
+    ConsoleReply waitForReply();
+};
+
+#endif
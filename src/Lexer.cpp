@@ -3,7 +3,7 @@
 #include <cctype>
 #include <algorithm>
 
-vector<string> functions{"tab", "int", "rnd", "str$", "val", "chr$"};
+vector<string> functions{"tab", "int", "rnd", "str$", "val", "chr$", "eof", "lof", "loc", "num"};
 
 Lexer::Lexer(string line) 
 {
@@ -45,6 +45,13 @@ struct LexToken *Lexer::keywords(struct LexToken *token)
         else if (ltext == "load") token->type = t_load;
         else if (ltext == "run") token->type = t_run;
         else if (ltext == "trun") token->type = t_trun;
+        else if (ltext == "jit") token->type = t_jit;
+        else if (ltext == "profile") token->type = t_profile;
+        else if (ltext == "trace") token->type = t_trace;
+        else if (ltext == "mem") token->type = t_mem;
+        else if (ltext == "history") token->type = t_history;
+        else if (ltext == "tron") token->type = t_tron;
+        else if (ltext == "troff") token->type = t_troff;
         else if (ltext == "list") token->type = t_list;
         else if (ltext == "data") token->type = t_data;
         else if (ltext == "for") token->type = t_for;
@@ -78,6 +85,12 @@ struct LexToken *Lexer::keywords(struct LexToken *token)
         else if (ltext == "as") token->type = t_as;
         else if (ltext == "output") token->type = t_output;
         else if (ltext == "close") token->type = t_close;
+        else if (ltext == "flush") token->type = t_flush;
+        else if (ltext == "random") token->type = t_random;
+        else if (ltext == "field") token->type = t_field;
+        else if (ltext == "get") token->type = t_get;
+        else if (ltext == "put") token->type = t_put;
+        else if (ltext == "mat") token->type = t_mat;
         else if (ltext == "inkey$") token->type = t_inkey;
         else if (ltext == "getkey") token->type = t_getkey;
         else if (ltext == "data") token->type = t_data;
@@ -3,6 +3,8 @@
 
 #include "main.hpp"
 
+#include <vector>
+
 enum TokenType {
     t_unknown, t_identifier, t_string, t_integer, t_real, t_keyword, t_period, t_colon,
     t_plus, t_dash, t_mult, t_div, t_leftparen, t_rightparen, t_equals, t_eol, t_caret,
@@ -11,7 +13,8 @@ enum TokenType {
     t_data, t_for, t_to, t_next, t_read, t_let, t_print, t_rem, t_goto, t_not,
     t_clear, t_end, t_semicolon, t_gosub, t_return, t_if, t_then, t_trun, t_function,
     t_input, t_at, t_open, t_as, t_output, t_hash, t_close, t_inkey, t_getkey, t_restore,
-    t_dim, t_else, t_using
+    t_dim, t_else, t_using, t_jit, t_profile, t_trace, t_mem, t_flush,
+    t_random, t_field, t_get, t_put, t_mat, t_tron, t_troff, t_history
 };
 
  extern vector<string> functions;
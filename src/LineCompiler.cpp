@@ -0,0 +1,314 @@
+#include "LineCompiler.hpp"
+#include "System.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+LineCompiler::LineCompiler(System *system)
+{
+    m_system = system;
+}
+
+LineCompiler::~LineCompiler()
+{
+    for (vector<CompiledExpression *>::iterator it = m_compiled.begin(); it != m_compiled.end(); it++)
+    {
+        delete *it;
+    }
+}
+
+void LineCompiler::reset(const map<int, ProgramLine *> &program)
+{
+    for (map<int, ProgramLine *>::const_iterator it = program.begin(); it != program.end(); it++)
+    {
+        it->second->executions = 0;
+        clear(it->second->node);
+    }
+
+    for (vector<CompiledExpression *>::iterator it = m_compiled.begin(); it != m_compiled.end(); it++)
+    {
+        delete *it;
+    }
+    m_compiled.clear();
+    m_compiledLines = 0;
+}
+
+void LineCompiler::clear(Node *node)
+{
+    if (!node) return;
+
+    node->compiled = nullptr;
+    clear(node->left);
+
+    // A GOSUB node's right points back at its own statement
+    if (node->type != nt_gosub) clear(node->right);
+}
+
+void LineCompiler::compile(ProgramLine *line)
+{
+    if (!line->node) return;
+
+    Node *currNode = line->node->left;
+    while (currNode)
+    {
+        statement(currNode);
+        currNode = currNode->right;
+    }
+    m_compiledLines++;
+}
+
+void LineCompiler::statement(Node *node)
+{
+    if (!node || !node->left) return;
+
+    Node *stmt = node->left;
+    Node *currNode = nullptr;
+    switch (stmt->type)
+    {
+        case nt_assign:
+            // "=" is not a comparison on the right of an assignment
+            m_inAssign = true;
+            root(stmt->left);
+            root(stmt->right);
+            m_inAssign = false;
+            break;
+        case nt_print:
+        case nt_printfile:
+            if (stmt->right) root(stmt->right->left);
+            currNode = stmt->left;
+            while (currNode)
+            {
+                root(currNode->left);
+                currNode = currNode->right;
+            }
+            break;
+        case nt_if:
+            root(stmt->left);
+            statement(stmt->right);
+            break;
+        case nt_else:
+            statement(stmt->left);
+            break;
+        case nt_for:
+            root(stmt->right->left);
+            root(stmt->right->right);
+            break;
+        case nt_input:
+        case nt_inputfile:
+        case nt_getkey:
+            if (stmt->left) root(stmt->left->right);
+            break;
+        case nt_read:
+            currNode = stmt->left;
+            while (currNode)
+            {
+                if (currNode->left) root(currNode->left->right);
+                currNode = currNode->right;
+            }
+            break;
+        case nt_goto:
+        case nt_gosub:
+        case nt_get:
+        case nt_put:
+            root(stmt->left);
+            break;
+        default:
+            break;
+    }
+}
+
+void LineCompiler::root(Node *node)
+{
+    if (!node) return;
+
+    function<Value()> code = valueCode(node);
+    if (code)
+    {
+        CompiledExpression *compiled = new CompiledExpression();
+        compiled->value = code;
+        m_compiled.push_back(compiled);
+        node->compiled = compiled;
+    } else
+    {
+        root(node->left);
+        root(node->right);
+    }
+}
+
+bool isArithmetic(NodeType type)
+{
+    return (type == nt_add || type == nt_minus || type == nt_mult || type == nt_div ||
+            type == nt_negate || type == nt_power);
+}
+
+bool isBoolean(NodeType type)
+{
+    return (type == nt_and || type == nt_or || type == nt_not || type == nt_equal ||
+            type == nt_notequal || type == nt_greater || type == nt_greaterequal ||
+            type == nt_less || type == nt_lessequal);
+}
+
+bool LineCompiler::isScalar(Node *node)
+{
+    return (node->type == nt_identifier && !node->right && node->text != "");
+}
+
+shared_ptr<VariableSlot> slotFor(Node *node)
+{
+    string id = node->text;
+    transform(id.begin(), id.end(), id.begin(),
+    [](unsigned char c){ return tolower(c); });
+    return make_shared<VariableSlot>(id);
+}
+
+function<Value()> LineCompiler::valueCode(Node *node)
+{
+    System *s = m_system;
+
+    if (node->type == nt_integer)
+    {
+        Value v = Value(stoi(node->text));
+        return [v]() { return v; };
+    } else if (node->type == nt_real)
+    {
+        Value v = Value(stof(node->text));
+        return [v]() { return v; };
+    } else if (node->type == nt_string)
+    {
+        Value v = Value(node->text);
+        return [v]() { return v; };
+    } else if (isScalar(node))
+    {
+        shared_ptr<VariableSlot> slot = slotFor(node);
+        return [s, slot]() {
+            Value *v = s->findVariable(*slot);
+            return (v ? *v : Value(0));
+        };
+    } else if (node->valueType == vt_integer && isArithmetic(node->type))
+    {
+        IntegerCode code = integerCode(node);
+        return [code]() { return Value(code()); };
+    } else if (node->valueType == vt_real && isArithmetic(node->type))
+    {
+        RealCode code = realCode(node);
+        return [code]() { return Value(code()); };
+    } else if (!m_inAssign && isBoolean(node->type))
+    {
+        BoolCode code = boolCode(node);
+        if (code) return [code]() { return Value(code()); };
+    }
+
+    return nullptr;
+}
+
+LineCompiler::IntegerCode LineCompiler::integerCode(Node *node)
+{
+    System *s = m_system;
+
+    if (node->type == nt_integer)
+    {
+        int i = stoi(node->text);
+        return [i]() { return i; };
+    } else if (isScalar(node))
+    {
+        shared_ptr<VariableSlot> slot = slotFor(node);
+        return [s, slot]() {
+            Value *v = s->findVariable(*slot);
+            return (v ? v->integer() : 0);
+        };
+    } else if (node->type == nt_add || node->type == nt_minus || node->type == nt_mult)
+    {
+        IntegerCode c1 = integerCode(node->left);
+        IntegerCode c2 = integerCode(node->right);
+        if (node->type == nt_add) return [c1, c2]() { return c1() + c2(); };
+        if (node->type == nt_minus) return [c1, c2]() { return c1() - c2(); };
+        return [c1, c2]() { return c1() * c2(); };
+    } else if (node->type == nt_negate)
+    {
+        IntegerCode c1 = integerCode(node->left);
+        return [c1]() { return c1() * -1; };
+    }
+
+    // Functions and array elements go back through the interpreter
+    root(node->left);
+    root(node->right);
+    return [s, node]() { return s->add(node).integer(); };
+}
+
+LineCompiler::RealCode LineCompiler::realCode(Node *node)
+{
+    System *s = m_system;
+
+    if (node->valueType == vt_integer)
+    {
+        IntegerCode c1 = integerCode(node);
+        return [c1]() { return float(c1()); };
+    } else if (node->type == nt_real)
+    {
+        float f = stof(node->text);
+        return [f]() { return f; };
+    } else if (isScalar(node))
+    {
+        shared_ptr<VariableSlot> slot = slotFor(node);
+        return [s, slot]() {
+            Value *v = s->findVariable(*slot);
+            return (v ? v->real() : float(0.0));
+        };
+    } else if (node->type == nt_add || node->type == nt_minus || node->type == nt_mult ||
+               node->type == nt_div || node->type == nt_power)
+    {
+        RealCode c1 = realCode(node->left);
+        RealCode c2 = realCode(node->right);
+        if (node->type == nt_add) return [c1, c2]() { return c1() + c2(); };
+        if (node->type == nt_minus) return [c1, c2]() { return c1() - c2(); };
+        if (node->type == nt_mult) return [c1, c2]() { return c1() * c2(); };
+        if (node->type == nt_div) return [c1, c2]() { return c1() / c2(); };
+        return [c1, c2]() { return float(pow(double(c1()), double(c2()))); };
+    } else if (node->type == nt_negate)
+    {
+        RealCode c1 = realCode(node->left);
+        return [c1]() { return float(c1() * -1.0); };
+    }
+
+    root(node->left);
+    root(node->right);
+    return [s, node]() { return s->add(node).real(); };
+}
+
+LineCompiler::BoolCode LineCompiler::boolCode(Node *node)
+{
+    if (isBoolean(node->type) && node->type != nt_and && node->type != nt_or && node->type != nt_not)
+    {
+        if (!node->left || !node->right) return nullptr;
+        if ((node->left->valueType != vt_integer && node->left->valueType != vt_real) ||
+            (node->right->valueType != vt_integer && node->right->valueType != vt_real)) return nullptr;
+
+        RealCode c1 = realCode(node->left);
+        RealCode c2 = realCode(node->right);
+        switch (node->type)
+        {
+            case nt_equal: return [c1, c2]() { return c1() == c2(); };
+            case nt_notequal: return [c1, c2]() { return c1() != c2(); };
+            case nt_greater: return [c1, c2]() { return c1() > c2(); };
+            case nt_less: return [c1, c2]() { return c1() < c2(); };
+            case nt_greaterequal: return [c1, c2]() { return c1() >= c2(); };
+            default: return [c1, c2]() { return c1() <= c2(); };
+        }
+    } else if (node->type == nt_and || node->type == nt_or)
+    {
+        BoolCode c1 = (node->left ? boolCode(node->left) : nullptr);
+        BoolCode c2 = (node->right ? boolCode(node->right) : nullptr);
+        if (!c1 || !c2) return nullptr;
+
+        // Both sides are always evaluated, as in System::boolExpression
+        if (node->type == nt_and) return [c1, c2]() { bool b1 = c1(); bool b2 = c2(); return b1 && b2; };
+        return [c1, c2]() { bool b1 = c1(); bool b2 = c2(); return b1 || b2; };
+    } else if (node->type == nt_not)
+    {
+        BoolCode c1 = (node->left ? boolCode(node->left) : nullptr);
+        if (!c1) return nullptr;
+        return [c1]() { return !c1(); };
+    }
+
+    return nullptr;
+}
@@ -0,0 +1,70 @@
+#ifndef _LINECOMPILER_HPP_
+#define _LINECOMPILER_HPP_
+
+#include "Parser.hpp"
+#include "Value.hpp"
+
+#include <map>
+#include <vector>
+#include <memory>
+#include <functional>
+
+class System;
+struct ProgramLine;
+
+struct VariableSlot {
+    string id;
+    Value *value = nullptr;
+    int generation = -1;
+
+    VariableSlot(string id)
+    {
+        this->id = id;
+    }
+};
+
+struct CompiledExpression {
+    function<Value()> value;
+};
+
+/*
+ * Second execution tier.  Once a program line has run often enough, its
+ * expressions are compiled into trees of closures that work on unboxed ints
+ * and floats, with literals parsed once and scalar variables bound to their
+ * storage.  The compiled root of each expression is hung off
+ * Node::compiled, which System::expression and System::add check first.
+ *
+ * Anything that needs the interpreter (I/O, functions, array elements)
+ * calls back into System, so results match the interpreter exactly.
+ */
+class LineCompiler {
+public:
+    LineCompiler(System *system);
+    ~LineCompiler();
+
+    void reset(const map<int, ProgramLine *> &program);
+    void compile(ProgramLine *line);
+    int compiledLines() const { return m_compiledLines; }
+
+private:
+    typedef function<int()> IntegerCode;
+    typedef function<float()> RealCode;
+    typedef function<bool()> BoolCode;
+
+    System *m_system;
+    vector<CompiledExpression *> m_compiled;
+    int m_compiledLines = 0;
+    bool m_inAssign = false;
+
+    void clear(Node *node);
+    void statement(Node *node);
+    void root(Node *node);
+
+    bool isScalar(Node *node);
+    function<Value()> valueCode(Node *node);
+    IntegerCode integerCode(Node *node);
+    RealCode realCode(Node *node);
+    BoolCode boolCode(Node *node);
+};
+
+#endif
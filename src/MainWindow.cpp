@@ -9,6 +9,8 @@
 #include "MainWindow.hpp"
 
 #include "main.hpp"
+#include "Counters.hpp"
+#include "Tracer.hpp"
 #include "FontManager.hpp"
 #include "System.hpp"
 
@@ -19,6 +21,7 @@
 #include <algorithm>
 #include <chrono>
 #include <cwctype>
+#include <cstdlib>
 
 MainWindow *mainWindow;
 
@@ -39,11 +42,23 @@ bool MainWindow::handleEvent(SDL_Event *e) {
         if (e->type == SDL_QUIT){
             loopResult = l_quitting;
             eventHandled = true;
+        } else if (e->type == SDL_WINDOWEVENT) {
+            // Uncovered, resized and so on: the next frame is drawn anyway
+            m_exposed = true;
         } else if (e->type == SDL_KEYDOWN && e->key.keysym.scancode == SDL_SCANCODE_ESCAPE) {
             loopResult = l_escape;
+            if (m_inputActive) cancelInput();
+            m_interpreter->wake();
             eventHandled = true;
         } else if (e->type == SDL_KEYDOWN) {
-            addCharacter(translateKey(e->key.keysym));
+            string key = translateKey(e->key.keysym);
+            SDL_Scancode scancode = e->key.keysym.scancode;
+            bool modifier = (scancode == SDL_SCANCODE_LSHIFT || scancode == SDL_SCANCODE_RSHIFT ||
+                key == "capslock" || key == "CapsLock");
+
+            // While a program runs, keys are for GETKEY and INKEY$
+            if (m_interpreter->busy() && loopResult != l_input && !modifier) m_interpreter->pushKey(key);
+            else addCharacter(key);
             eventHandled = true;
         }
     }
@@ -56,15 +71,17 @@ MainWindow::MainWindow(int lineSize, int lineCount, int fontSize) : Window() {
     this->m_lineSize = lineSize;
     this->m_lineCount = lineCount;
 
+    setFrameRate(FRAME_RATE);
+
     m_text = vector<string>(m_lineCount);
+    m_dirtyRows = vector<bool>(m_lineCount, true);
 
-    SDL_Surface* text = TTF_RenderText_Solid(fontManager->getFont(fontManager->SOURCECODEPRO, m_fontSize), "g", {128, 128, 128, 255});
-    textWidth = text->w;
-    textHeight = text->h;
-    SDL_FreeSurface(text);
+    SDL_Point cell = fontManager->cellSize(FontManager::SOURCECODEPRO, m_fontSize);
+    textWidth = cell.x;
+    textHeight = cell.y;
 
     for (int i = 0; i < m_lineCount; i++) {
-        m_text[i] = string(m_lineSize, ' ');
+        textRow(i) = string(m_lineSize, ' ');
     }
 
     m_screenWidth = textWidth * m_lineSize + 10;
@@ -91,7 +108,13 @@ MainWindow::MainWindow(int lineSize, int lineCount, int fontSize) : Window() {
     // game->screenWidth = w;
     // game->screenHeight = h;
     
-    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+    // Not PRESENTVSYNC: render() paces frames itself, and a present that
+    // blocked for the display would hold up the program as well
+    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+    if (renderer == nullptr) {
+        // No GPU, or no display at all
+        renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_SOFTWARE | SDL_RENDERER_TARGETTEXTURE);
+    }
     if (renderer == nullptr) {
         logSDLError("CreateRenderer");
         SDL_Quit();
@@ -101,6 +124,12 @@ MainWindow::MainWindow(int lineSize, int lineCount, int fontSize) : Window() {
 
     addText("KBASIC v1.0");
     addText("Ready");
+
+    const char *recording = getenv("KBASIC_RECORD");
+    if (recording) m_recording.open(recording);
+
+    m_interpreter = new InterpreterThread(m_lineSize, m_lineCount);
+    m_interpreter->start();
 }
 
 void MainWindow::mapKeys() {
@@ -127,12 +156,45 @@ void MainWindow::mapKeys() {
     keyMap[SDL_SCANCODE_BACKSLASH] = "|";
 }
 
-bool MainWindow::loop() 
-{
-    return mainLoop();
+// Applies what the interpreter has sent since the last frame.  Taking no
+// more than a queue's worth keeps a chatty program from starving events.
+void MainWindow::update() {
+    ConsoleCommand command;
+    for (int i = 0; i < MAX_COMMANDS_PER_UPDATE && m_interpreter->receive(command); i++) {
+        apply(command);
+    }
+}
+
+void MainWindow::apply(const ConsoleCommand &command) {
+    if (m_recording.is_open()) {
+        string record = toRecord(command);
+        if (!record.empty()) m_recording << record << '\n';
+    }
+
+    ConsoleReply reply;
+    switch (command.op) {
+        case co_addText: addText(command.text, command.appendMode); break;
+        case co_putTextAt: putTextAt(command.col, command.text, command.appendMode); break;
+        case co_clearText: clearText(); break;
+        case co_setCursorPos: setCursorPos(CursorPos(command.col, command.row)); break;
+        case co_getCursorPos:
+            reply.col = m_cursorPos;
+            reply.row = m_cursorLine;
+            m_interpreter->reply(reply);
+            break;
+        case co_input: beginInput(command.text, command.number); break;
+        case co_terminate: terminate(); break;
+        case co_done: m_cursorPos = 0; break;
+    }
 }
 
 void MainWindow::cleanup() {
+    // Stop a running program before the thread is joined
+    loopResult = l_quitting;
+    m_interpreter->stop();
+    delete m_interpreter;
+    m_interpreter = nullptr;
+
     std::list<Window *>::iterator i;
     for(i = children.begin(); i != children.end(); ++i) {
         (*i)->cleanup();
@@ -140,13 +202,54 @@ void MainWindow::cleanup() {
     
     freeTextures();
 
-    if (m_cursorTexture) SDL_DestroyTexture(m_cursorTexture);
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
+    fontManager->cleanup();
     SDL_Quit();
 }
 
+void MainWindow::setFrameRate(int framesPerSecond) {
+    m_frameInterval = duration_cast<steady_clock::duration>(seconds(1)) / max(1, framesPerSecond);
+    m_lastFrame = steady_clock::now() - m_frameInterval;
+}
+
+// How long the event loop can sleep: until the cursor next blinks or,
+// when there is something to draw or a program is sending output, until
+// the next frame is due.  The interpreter queues its last output before
+// it stops being busy, so output left in the queue counts as well.
+int MainWindow::idleTimeout() {
+    steady_clock::time_point now = steady_clock::now();
+    steady_clock::duration timeout = m_lastCursorUpdate + CURSOR_BLINK - now;
+    if (needsRender() || m_interpreter->busy() || m_interpreter->pending()) {
+        timeout = min(timeout, m_lastFrame + m_frameInterval - now);
+    }
+
+    return max(0, int(ceil<milliseconds>(timeout).count()));
+}
+
+// Where the cursor would be drawn now, or -1 if it wouldn't be
+int MainWindow::cursorState() const {
+    bool visible = (executionStatus != ex_executing || loopResult == l_input);
+    if (!visible || !m_cursorOn) return -1;
+    return m_cursorLine * m_lineSize + m_cursorPos;
+}
+
+bool MainWindow::needsRender() const {
+    return consoleTextDirty || m_exposed || cursorState() != m_drawnCursor;
+}
+
 void MainWindow::render(bool forceRedraw) {
+    steady_clock::time_point now = steady_clock::now();
+    if (now - m_lastCursorUpdate >= CURSOR_BLINK) {
+        m_lastCursorUpdate = now;
+        m_cursorOn = !m_cursorOn;
+    }
+
+    if (!forceRedraw && (now - m_lastFrame < m_frameInterval || !needsRender())) return;
+    m_lastFrame = now;
+    m_exposed = false;
+    TraceSpan span("frame", -1, tt_ui);
+
     SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
     SDL_RenderClear(renderer);
 
@@ -159,63 +262,104 @@ void MainWindow::render(bool forceRedraw) {
     }
 
     SDL_RenderPresent(renderer);
+    tally(counters.frames);
 }
 
 void MainWindow::createTextures() {
-    freeTextures();
+    // The font is rasterized once; after that the screen is drawn a
+    // character cell at a time from the atlas
+    if (!m_atlas) {
+        m_atlas = new GlyphAtlas(getRenderer(),
+            fontManager->getFont(FontManager::SOURCECODEPRO, m_fontSize),
+            textWidth,
+            textHeight);
+    }
+
+    SDL_SetRenderDrawColor(getRenderer(), 0, 0, 0, 0);
+    if (!m_screenTexture) {
+        m_screenTexture = createScreenTexture();
+        m_scrollTexture = createScreenTexture();
+
+        SDL_SetRenderTarget(getRenderer(), m_screenTexture);
+        SDL_RenderClear(getRenderer());
+        markAllDirty();
+    } else if (m_pendingScroll > 0) {
+        // A texture can't be copied onto itself, so the rows that are
+        // still on screen move up by way of the second texture
+        int kept = m_lineCount - m_pendingScroll;
+        SDL_SetRenderTarget(getRenderer(), m_scrollTexture);
+        SDL_RenderClear(getRenderer());
+
+        SDL_Rect src = {0, m_pendingScroll * textHeight + 5, m_screenWidth, kept * textHeight};
+        SDL_Rect dst = {0, 5, m_screenWidth, kept * textHeight};
+        SDL_RenderCopy(getRenderer(), m_screenTexture, &src, &dst);
+        swap(m_screenTexture, m_scrollTexture);
+    } else {
+        SDL_SetRenderTarget(getRenderer(), m_screenTexture);
+    }
+    m_pendingScroll = 0;
+
+    // The texture persists between frames, so only rows that changed
+    // since the last one are cleared and drawn again
+    for (int i = 0; i < m_lineCount; i++) {
+        int slot = (m_topRow + i) % m_lineCount;
+        if (!m_dirtyRows[slot]) continue;
 
-//    SDL_Renderer *target = getRenderer();
+        SDL_Rect row = {0, i * textHeight + 5, m_screenWidth, textHeight};
+        SDL_RenderFillRect(getRenderer(), &row);
 
-    m_screenTexture = SDL_CreateTexture(getRenderer(), 
+        const string &line = m_text[slot];
+        for (int j = 0; j < static_cast<int>(line.size()); j++) {
+            if (line[j] != ' ') m_atlas->draw(getRenderer(), line[j], j * textWidth + 5, i * textHeight + 5);
+        }
+        m_dirtyRows[slot] = false;
+    }
+
+    SDL_SetRenderTarget(getRenderer(), NULL);
+    consoleTextDirty = false;
+}
+
+SDL_Texture *MainWindow::createScreenTexture() {
+    return SDL_CreateTexture(getRenderer(), 
             SDL_PIXELFORMAT_RGBA8888, 
             SDL_TEXTUREACCESS_TARGET,
             m_screenWidth,
             m_screenHeight);
+}
 
-    SDL_SetRenderTarget(getRenderer(), m_screenTexture);
-    SDL_SetRenderDrawColor(getRenderer(), 0, 0, 0, 0);
-    SDL_RenderClear(getRenderer());
+string &MainWindow::textRow(int line) {
+    return m_text[(m_topRow + line) % m_lineCount];
+}
 
-    for (int i = 0; i < m_lineCount; i++) {
-        SDL_Texture *t = renderText(m_text[i],
-            fontManager->getFont(FontManager::SOURCECODEPRO, m_fontSize),
-            {255, 255, 255, 255},
-            getRenderer());
-        
-        renderTexture(t, getRenderer(), 5, i * textHeight + 5);
-    }
+void MainWindow::markDirty(int line) {
+    if (line < 0 || line >= m_lineCount) return;
 
-    SDL_SetRenderTarget(getRenderer(), NULL);
-    consoleTextDirty = false;
+    m_dirtyRows[(m_topRow + line) % m_lineCount] = true;
+    consoleTextDirty = true;
+}
+
+void MainWindow::markAllDirty() {
+    fill(m_dirtyRows.begin(), m_dirtyRows.end(), true);
+    m_pendingScroll = 0;
+    consoleTextDirty = true;
 }
 
 void MainWindow::freeTextures() {
     if (m_screenTexture) SDL_DestroyTexture(m_screenTexture);
+    if (m_scrollTexture) SDL_DestroyTexture(m_scrollTexture);
+    m_screenTexture = nullptr;
+    m_scrollTexture = nullptr;
+
+    delete m_atlas;
+    m_atlas = nullptr;
 }
 
 void MainWindow::renderCursor() {
-    if (!m_cursorTexture)
-    {    
-        m_cursorTexture = renderText("_", fontManager->getFont(fontManager->SOURCECODEPRO, m_fontSize), {255, 255, 255, 255}, getRenderer());
-    }
-
-    auto finish = high_resolution_clock::now();
-    duration elapsed = duration_cast<milliseconds>(finish - m_lastCursorUpdate);
-    if (elapsed.count() > 500)
+    m_drawnCursor = cursorState();
+    if (m_drawnCursor >= 0 && m_atlas)
     {
-        m_lastCursorUpdate = finish;
-        m_cursorOn = !m_cursorOn;
-    } 
-
-    
-    if (executionStatus != ex_executing || loopResult == l_input)
-    {
-        if (m_cursorOn)
-        {
-            renderTexture(m_cursorTexture, getRenderer(), m_cursorPos * textWidth + 5, m_cursorLine * textHeight + 5);    
-        }
+        m_atlas->draw(getRenderer(), '_', m_cursorPos * textWidth + 5, m_cursorLine * textHeight + 5);
     }
-    
 }
 
 void MainWindow::renderOutput() {
@@ -229,7 +373,8 @@ void MainWindow::renderOutput() {
 };
 
 void MainWindow::addText(string s, PrintAppendMode appendMode) {
-    m_text[m_cursorLine].replace(m_cursorPos, s.size(), s);
+    textRow(m_cursorLine).replace(m_cursorPos, s.size(), s);
+    markDirty(m_cursorLine);
     if (appendMode == pam_none) 
     {
         newLine();
@@ -245,23 +390,23 @@ void MainWindow::addText(string s, PrintAppendMode appendMode) {
     {
         m_cursorPos += s.size();
     }
-    consoleTextDirty = true;
 }
 
 void MainWindow::newLine()
 {
     if (m_cursorLine >= m_lineCount - 1)
     {
-        for (int i = 0; i < m_lineCount - 1; i++)
-        {
-            m_text[i] = m_text[i+1];
-        }
-        m_text[m_lineCount - 1] = string(m_lineSize, ' ');
+        // The old top row becomes the new, blank, bottom one
+        m_topRow = (m_topRow + 1) % m_lineCount;
+        textRow(m_lineCount - 1).assign(m_lineSize, ' ');
+
+        if (m_pendingScroll < m_lineCount - 1) m_pendingScroll++;
+        else markAllDirty();
+        markDirty(m_lineCount - 1);
     } else 
     {
         m_cursorLine++;
     }
-    consoleTextDirty = true;
 }
 
 void MainWindow::addCharacter(string c) {
@@ -269,6 +414,7 @@ void MainWindow::addCharacter(string c) {
         capsLock = !capsLock;
         return;
     } else if (loopResult != l_running && loopResult != l_input) return;
+    else if (loopResult != l_input && m_interpreter->busy()) return;
 
     if (c.size() == 1) {
         if (m_cursorPos >= m_lineSize)
@@ -276,32 +422,32 @@ void MainWindow::addCharacter(string c) {
             m_cursorPos = 0;
         }
 
-        m_text[m_cursorLine].replace(m_cursorPos++, 1, c);
-        consoleTextDirty = true;
+        textRow(m_cursorLine).replace(m_cursorPos++, 1, c);
+        markDirty(m_cursorLine);
     } else if (c == "return" || c == "Return") {
         if (loopResult == l_input)
         {
             loopResult = l_endInput;
-            m_inputBuffer = m_text[m_cursorLine].substr(m_inputStartPos, m_lineSize);
+            m_inputBuffer = textRow(m_cursorLine).substr(m_inputStartPos, m_lineSize);
             rtrim(m_inputBuffer);
             m_cursorPos=0;
             newLine();
+            finishInput();
         } else 
         {
             // Just in case there happens to be anything after the 
             // cursor when you hit Return
-            string s = m_text[m_cursorLine];
+            string s = textRow(m_cursorLine);
             m_cursorPos = 0;
             newLine();
-            core->command(s, this);
-            m_cursorPos = 0;
+            m_interpreter->submit(s);
         }
     } else if (c == "backspace" || c == "Backspace") {
         if ((m_cursorPos > 0 && loopResult != l_input) || m_cursorPos > m_inputStartPos)
         {
-            m_text[m_cursorLine].replace(m_cursorPos - 1, 1, " ");
+            textRow(m_cursorLine).replace(m_cursorPos - 1, 1, " ");
             m_cursorPos--;
-            consoleTextDirty = true;
+            markDirty(m_cursorLine);
         }
     } else if (c == "home")
     {
@@ -310,7 +456,7 @@ void MainWindow::addCharacter(string c) {
     } else if (c == "end")
     {
         int i = m_lineSize - 1;
-        for (; i >= 0; i--) if (!iswspace(m_text[m_cursorLine].at(i))) break;
+        for (; i >= 0; i--) if (!iswspace(textRow(m_cursorLine).at(i))) break;
         m_cursorPos = i + 1;
         if (loopResult == l_input && i < m_inputStartPos)
         {
@@ -335,10 +481,10 @@ void MainWindow::addCharacter(string c) {
         else if (loopResult != l_input) newLine();
     } else if (c == "delete")
     {
-        m_text[m_cursorLine] = m_text[m_cursorLine].substr(0, m_cursorPos) + 
-                               m_text[m_cursorLine].substr(m_cursorPos +1, m_lineSize) +
+        textRow(m_cursorLine) = textRow(m_cursorLine).substr(0, m_cursorPos) + 
+                               textRow(m_cursorLine).substr(m_cursorPos +1, m_lineSize) +
                                " ";
-        consoleTextDirty = true;
+        markDirty(m_cursorLine);
     } else {
         cout << "Unhandled key: " << c << endl;
     }
@@ -391,12 +537,12 @@ void MainWindow::putTextAt(int location, string s, PrintAppendMode pmode)
 void MainWindow::clearText() {
     for (int i = 0; i < m_lineCount; i++)
     {
-        m_text[i] = string(m_lineSize, ' ');
+        textRow(i) = string(m_lineSize, ' ');
     }
 
     m_cursorPos = 0;
     m_cursorLine = 0;
-    consoleTextDirty = true;
+    markAllDirty();
 }
 
 void MainWindow::terminate() {
@@ -405,84 +551,49 @@ void MainWindow::terminate() {
     SDL_PushEvent(&sdlevent);
 }
 
-string MainWindow::getKey()
+// INPUT and INPUT$ on the interpreter thread wait while the line is typed
+// here; the reply goes back once Return gives an acceptable answer
+void MainWindow::beginInput(const string &prompt, bool number)
 {
-    int numKeys;
-    const Uint8 *state = SDL_GetKeyboardState(&numKeys);
-    bool shifted = (state[SDL_SCANCODE_LSHIFT] || state[SDL_SCANCODE_RSHIFT]);
+    addText(prompt + "? ", pam_append);
 
-    for (int i = 0; i < numKeys; i++)
-    {
-        if (i == SDL_SCANCODE_LSHIFT || i == SDL_SCANCODE_RSHIFT) continue;
-
-        if (state[i]) return translateKey(static_cast<SDL_Scancode>(i), shifted);
-    }
-
-    return "";
-}
-
-float MainWindow::inputNumber(string prompt)
-{
-    float result = 0.0;
-    addText(prompt + "? ", pam_append);    
-
-    LoopStatus oldLoopResult = loopResult;
+    m_inputActive = true;
+    m_inputPrompt = prompt;
+    m_inputNumber = number;
+    m_inputReturnStatus = loopResult;
     loopResult = l_input;
     m_inputStartPos = m_cursorPos;
+}
 
-    bool quitting = false;
-    while (!quitting){
-        quitting = (mainLoop() == l_quitting);
-        if (loopResult == l_escape)
-        {
-            addText("Break");
-            break;
-        } else if (loopResult == l_endInput)
-        {
-            if (m_inputBuffer == "")
-            {
-                break;
-            } else if  (isFloat(m_inputBuffer)) 
-            {
-                result = stof(m_inputBuffer);
-                break;
-            } else 
-            {
-                addText("Type mismatch");
-                addText(prompt + "? ", pam_append);
-                loopResult = l_input;
-            }
-        }
+void MainWindow::finishInput()
+{
+    if (m_inputNumber && m_inputBuffer != "" && !isFloat(m_inputBuffer))
+    {
+        addText("Type mismatch");
+        addText(m_inputPrompt + "? ", pam_append);
+        loopResult = l_input;
+        m_inputStartPos = m_cursorPos;
+        return;
     }
 
-    if (loopResult == l_escape) loopResult = l_end;
-    else loopResult = oldLoopResult;
-    return result;
+    m_inputActive = false;
+    loopResult = m_inputReturnStatus;
+
+    ConsoleReply reply;
+    reply.text = m_inputBuffer;
+    m_interpreter->reply(reply);
 }
 
-string MainWindow::inputString(string prompt)
+void MainWindow::cancelInput()
 {
-    addText(prompt + "? ", pam_append);    
-
-    LoopStatus oldLoopResult = loopResult;
-    loopResult = l_input;
-    m_inputStartPos = m_cursorPos;
+    addText("Break");
 
-    bool quitting = false;
-    while (!quitting){
-        quitting = (mainLoop() == l_quitting);
-        if (loopResult == l_endInput) break;
-        else if (loopResult == l_escape) 
-        {
-            m_inputBuffer = "";
-            addText("Break");
-            break;
-        }
-    }
+    m_inputActive = false;
+    loopResult = l_end;
 
-    if (loopResult == l_escape) loopResult = l_end;
-    else loopResult = oldLoopResult;
-    return m_inputBuffer;
+    ConsoleReply reply;
+    reply.escaped = true;
+    m_interpreter->reply(reply);
 }
 
 CursorPos MainWindow::getCursorPos()
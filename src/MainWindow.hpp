@@ -11,38 +11,45 @@
 
 #include "Window.hpp"
 #include "Console.hpp"
+#include "GlyphAtlas.hpp"
+#include "InterpreterThread.hpp"
 #include "main.hpp"
 
 #include <vector>
 #include <array>
 #include <unordered_map>
 #include <chrono>
+#include <fstream>
 
 using namespace std::chrono;
 
-class MainWindow : public Window, Console {
+class MainWindow : public Window {
 public:
     MainWindow(int lineSize, int lineCount, int fontSize);
     
+    // Draws a frame only if one is due at the frame rate and something on
+    // screen has changed, unless forced
     virtual void render(bool forceRedraw);
+    int idleTimeout();
+    void setFrameRate(int framesPerSecond);
     virtual void cleanup();
     virtual bool handleEvent(SDL_Event *e);
 
     void addCharacter(string c);
 
+    // Applies the interpreter's queued console output; called every frame
+    void update();
+    void apply(const ConsoleCommand &command);
+
     int fontSize() { return m_fontSize; }
 
-    // ConsoleOutput interface
+    // The console operations, carried out on the UI thread
     void addText(string s, PrintAppendMode appendMode = pam_none);
     void putTextAt(int location, string s, PrintAppendMode appendMode = pam_none);
     void clearText();
     void terminate();
     inline int lineSize() { return m_lineSize; };
     inline int lineCount() { return m_lineCount; }
-    bool loop();
-    float inputNumber(string prompt);
-    string inputString(string prompt);
-    string getKey();
     CursorPos getCursorPos();
     void setCursorPos(const CursorPos &pos);
 
@@ -63,23 +70,59 @@ private:
     int m_inputStartPos = 0;
     string m_inputBuffer = "";
 
+    static const int MAX_COMMANDS_PER_UPDATE = 4096;
+    InterpreterThread *m_interpreter = nullptr;
+    ofstream m_recording;       // Screen output, if $KBASIC_RECORD names a file
+
+    bool m_inputActive = false;
+    bool m_inputNumber = false;
+    string m_inputPrompt;
+    LoopStatus m_inputReturnStatus = l_running;
+    void beginInput(const string &prompt, bool number);
+    void finishInput();
+    void cancelInput();
+
     int textWidth = 0;
     int textHeight = 0;
 
     bool capsLock = false;
 
+    steady_clock::duration m_frameInterval;
+    steady_clock::time_point m_lastFrame;
+
     void renderOutput();
     void renderCursor();
-    time_point<high_resolution_clock> m_lastCursorUpdate = high_resolution_clock::now();
+    const milliseconds CURSOR_BLINK = milliseconds(500);
+    steady_clock::time_point m_lastCursorUpdate = steady_clock::now();
     bool m_cursorOn = true;
+    int m_drawnCursor = -1;
+    bool m_exposed = true;
+    int cursorState() const;
+    bool needsRender() const;
 
     void newLine();
 
+    // consoleTextDirty is set whenever any of m_dirtyRows is; they are
+    // indexed like m_text, so a row's bit moves with it when it scrolls
     bool consoleTextDirty = false;
+    vector<bool> m_dirtyRows;
+    void markDirty(int line);
+    void markAllDirty();
 
+    // The screen's rows as a ring: screen line 0 is m_text[m_topRow], so
+    // scrolling moves m_topRow instead of copying every row
     vector<string> m_text;
+    int m_topRow = 0;
+    string &textRow(int line);
+
+    // Rows scrolled off since the screen texture was last updated; it is
+    // shifted up by this many rows rather than redrawn
+    int m_pendingScroll = 0;
+
     SDL_Texture *m_screenTexture = nullptr;
-    SDL_Texture *m_cursorTexture = nullptr;
+    SDL_Texture *m_scrollTexture = nullptr;
+    SDL_Texture *createScreenTexture();
+    GlyphAtlas *m_atlas = nullptr;
     unordered_map<int, string> keyMap;
 
     void mapKeys();
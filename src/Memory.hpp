@@ -0,0 +1,72 @@
+#ifndef _MEMORY_HPP_
+#define _MEMORY_HPP_
+
+#include "main.hpp"
+
+#include <cstddef>
+
+enum MemoryCategory { mc_variables, mc_arrays, mc_strings, mc_program, mc_data, mc_files, mc_count };
+
+// Bytes a std::map node adds to its key and value: three links and a colour
+const size_t MAP_NODE_BYTES = 4 * sizeof(void *);
+
+// Longest string kept inside the string object itself
+inline const size_t STRING_IN_PLACE = string().capacity();
+
+// Bytes the string has allocated on the heap
+inline size_t heapBytes(const string &s)
+{
+    return (s.capacity() > STRING_IN_PLACE ? s.capacity() + 1 : 0);
+}
+
+/*
+ * The bytes the interpreter holds in each category, for MEM, and the most
+ * each has held since kbasic started.  The interpreter keeps the counts
+ * up to date as it changes what they measure, so the high-water marks
+ * catch peaks between MEM commands.  They're estimates from the sizes of
+ * the structures involved, not what the allocator actually handed out.
+ * Strings are the heap part of every string variable and array element;
+ * the variables and arrays categories are the rest.
+ */
+class MemoryAccount {
+public:
+    void add(MemoryCategory category, size_t n)
+    {
+        m_bytes[category] += n;
+        m_total += n;
+        if (m_bytes[category] > m_peak[category]) m_peak[category] = m_bytes[category];
+        if (m_total > m_totalPeak) m_totalPeak = m_total;
+    }
+
+    void remove(MemoryCategory category, size_t n)
+    {
+        if (n > m_bytes[category]) n = m_bytes[category];
+        m_bytes[category] -= n;
+        m_total -= n;
+    }
+
+    void set(MemoryCategory category, size_t n)
+    {
+        remove(category, m_bytes[category]);
+        add(category, n);
+    }
+
+    size_t bytes(MemoryCategory category) const { return m_bytes[category]; }
+    size_t peak(MemoryCategory category) const { return m_peak[category]; }
+    size_t total() const { return m_total; }
+    size_t totalPeak() const { return m_totalPeak; }
+
+    static string name(MemoryCategory category)
+    {
+        static const char *names[mc_count] = { "Variables", "Arrays", "Strings", "Program", "DATA", "Files" };
+        return names[category];
+    }
+
+private:
+    size_t m_bytes[mc_count] = {};
+    size_t m_peak[mc_count] = {};
+    size_t m_total = 0;
+    size_t m_totalPeak = 0;
+};
+
+#endif
@@ -1,5 +1,7 @@
 #include "Parser.hpp"
 
+#include <algorithm>
+
 Parser::Parser(Lexer *l) 
 {
     m_lexer = l;
@@ -88,12 +90,17 @@ Node *Parser::command()
     if (t->type == t_load) result = load(t);
     else if (t->type == t_new) result = new_(t);
     else if (t->type == t_stat) result = stat(t);
+    else if (t->type == t_mem) result = mem(t);
+    else if (t->type == t_history) result = history(t);
     else if (t->type == t_bye) result = bye(t);
     else if (t->type == t_list) result = list(t);
     else if (t->type == t_files) result = files(t);
     else if (t->type == t_save) result = save(t);
     else if (t->type == t_run) result = run(t);
     else if (t->type == t_trun) result = trun(t);
+    else if (t->type == t_jit) result = jit(t);
+    else if (t->type == t_profile) result = onOffOrFile(t, nt_profile);
+    else if (t->type == t_trace) result = onOffOrFile(t, nt_trace);
     else result = lines(t);
 
     free(t);
@@ -109,6 +116,7 @@ Node *Parser::statements(LexToken *token)
     {
         LexToken *t = m_lexer->next();
         currNode->right = statement(t);
+        if (currNode->right) currNode->right->position = currNode->position + 1;
         free(t);
         currNode = currNode->right;
     }
@@ -196,11 +204,18 @@ Node *Parser::statement(LexToken *token)
     else if (token->type == t_clear) result->left = clear(token);
     else if (token->type == t_scnclr) result->left = scnclr(token);
     else if (token->type == t_end) result->left = end(token);
+    else if (token->type == t_tron) result->left = tron(token);
+    else if (token->type == t_troff) result->left = troff(token);
     else if (token->type == t_if) result->left = if_(token);
     else if (token->type == t_else) result->left = else_(token);
     else if (token->type == t_input) result->left = input(token);
     else if (token->type == t_open) result->left = open(token);
     else if (token->type == t_close) result->left = close(token);
+    else if (token->type == t_flush) result->left = flush(token);
+    else if (token->type == t_field) result->left = field(token);
+    else if (token->type == t_get) result->left = record(token, nt_get);
+    else if (token->type == t_put) result->left = record(token, nt_put);
+    else if (token->type == t_mat) result->left = mat(token);
     else if (token->type == t_getkey) result->left = getkey(token);
     else if (token->type == t_data) result->left = data(token);
     else if (token->type == t_read) result->left = read(token);
@@ -239,6 +254,16 @@ Node *Parser::end(LexToken *token)
     return new Node(nt_end, token->text);
 }
 
+Node *Parser::tron(LexToken *token) 
+{
+    return new Node(nt_tron, token->text);
+}
+
+Node *Parser::troff(LexToken *token) 
+{
+    return new Node(nt_troff, token->text);
+}
+
 Node *Parser::idList(LexToken *token) 
 {
     if (token && token->type != t_identifier)
@@ -349,6 +374,137 @@ Node *Parser::close(LexToken *token)
     return result;
 }
 
+Node *Parser::flush(LexToken *token)
+{
+    Node *result = new Node(nt_flush, token->text);
+
+    LexToken *t = m_lexer->next();
+    if (t && t->type == t_hash)
+    {
+        result->left = callWithNext(&Parser::integer);
+        if (!result->left) m_errors.push_back(ParseError("Expected file number after #"));
+    } else if (t && t->type == t_identifier)
+    {
+        // FLUSH EVERY <milliseconds>
+        result->right = new Node(nt_identifier, t->text);
+        result->left = callWithNext(&Parser::integer);
+        if (!result->left) m_errors.push_back(ParseError("Expected INTEGER after \"" + t->text + "\""));
+    } else if (t)
+    {
+        m_lexer->pushBack(t);
+        t = nullptr;
+    }
+    free(t);
+
+    return result;
+}
+
+Node *Parser::field(LexToken *token)
+{
+    Node *result = new Node(nt_field, token->text);
+    if (!swallowNext(t_hash)) return result;
+
+    result->right = callWithNext(&Parser::integer);
+    if (!result->right)
+    {
+        m_errors.push_back(ParseError("Expected file number after #"));
+        return result;
+    }
+
+    // Each field is <width> AS <variable>
+    Node *last = nullptr;
+    while (matchNext(t_comma))
+    {
+        Node *width = callWithNext(&Parser::integer);
+        if (!width)
+        {
+            m_errors.push_back(ParseError("Expected field width in FIELD"));
+            return result;
+        }
+        if (!swallowNext(t_as))
+        {
+            free(width);
+            return result;
+        }
+
+        LexToken *t = m_lexer->next();
+        if (!t || t->type != t_identifier)
+        {
+            m_errors.push_back(ParseError("Expected ID for FIELD"));
+            free(width);
+            free(t);
+            return result;
+        }
+
+        Node *item = newNode(new Node(nt_identifier, t->text), nt_as, width->text, nullptr);
+        free(width);
+        free(t);
+        if (last) last->right = item;
+        else result->left = item;
+        last = item;
+    }
+
+    if (!result->left) m_errors.push_back(ParseError("Expected field list for FIELD"));
+    return result;
+}
+
+// GET #n [, record] and PUT #n [, record]
+Node *Parser::record(LexToken *token, NodeType type)
+{
+    Node *result = new Node(type, token->text);
+    if (!swallowNext(t_hash)) return result;
+
+    result->right = callWithNext(&Parser::integer);
+    if (!result->right)
+    {
+        m_errors.push_back(ParseError("Expected file number after #"));
+        return result;
+    }
+
+    if (matchNext(t_comma))
+    {
+        result->left = callWithNext(&Parser::expression);
+        if (!result->left) m_errors.push_back(ParseError("Expected record number"));
+    }
+
+    return result;
+}
+
+// MAT INPUT #n, array
+Node *Parser::mat(LexToken *token)
+{
+    Node *result = new Node(nt_matinput, token->text);
+    LexToken *t = m_lexer->next();
+    bool isInput = (t && t->type == t_input);
+    free(t);
+    if (!isInput)
+    {
+        m_errors.push_back(ParseError("Expected INPUT after MAT"));
+        return result;
+    }
+    if (!swallowNext(t_hash)) return result;
+
+    result->right = callWithNext(&Parser::integer);
+    if (!result->right)
+    {
+        m_errors.push_back(ParseError("Expected file number after #"));
+        return result;
+    }
+    if (!swallowNext(t_comma)) return result;
+
+    t = m_lexer->next();
+    if (!t || t->type != t_identifier)
+    {
+        m_errors.push_back(ParseError("Expected array name for MAT INPUT"));
+    } else
+    {
+        result->left = new Node(nt_identifier, t->text);
+    }
+    free(t);
+
+    return result;
+}
+
 Node *Parser::open(LexToken *token)
 {
     Node *result = new Node(nt_open, token->text);
@@ -387,13 +543,16 @@ Node *Parser::for_as(LexToken *token)
     LexToken *t = m_lexer->next();
     if (!t)
     {
-        m_errors.push_back(ParseError("Expecting INPUT or OUTPUT; found empty"));
-    } else if (t->type != t_input && t->type != t_output)
+        m_errors.push_back(ParseError("Expecting INPUT, OUTPUT or RANDOM; found empty"));
+    } else if (t->type != t_input && t->type != t_output && t->type != t_random)
     {
-        m_errors.push_back(ParseError("Expecting INPUT or OUTPUT; found \"" + t->text + "\""));
+        m_errors.push_back(ParseError("Expecting INPUT, OUTPUT or RANDOM; found \"" + t->text + "\""));
     } else if (t->type == t_input)
     {
         result->left = new Node(nt_input, t->text);
+    } else if (t->type == t_random)
+    {
+        result->left = new Node(nt_random, t->text);
     } else 
     {
         result->left = new Node(nt_output, t->text);
@@ -405,6 +564,29 @@ Node *Parser::for_as(LexToken *token)
 
     result->right = callWithNext(&Parser::integer);
 
+    // The record length of a RANDOM file (LEN = n), or ASYNC for an OUTPUT
+    // file written from a background thread
+    if (result->left && result->left->type != nt_input)
+    {
+        t = m_lexer->next();
+        string ltext = (t ? t->text : "");
+        transform(ltext.begin(), ltext.end(), ltext.begin(), [](unsigned char c){ return tolower(c); });
+        if (ltext == "len" && result->left->type == nt_random)
+        {
+            swallowNext(t_equals);
+            result->left->left = callWithNext(&Parser::integer);
+            if (!result->left->left) m_errors.push_back(ParseError("Expected record length after LEN"));
+        } else if (ltext == "async" && result->left->type == nt_output)
+        {
+            result->left->data = "async";
+        } else if (t)
+        {
+            m_lexer->pushBack(t);
+            t = nullptr;
+        }
+        free(t);
+    }
+
     return result;
 }
 
@@ -1080,10 +1262,52 @@ Node *Parser::IntegerRange(LexToken *token)
 
 
 Node *Parser::stat(LexToken *token)
+{
+    Node *result = new Node(nt_stat, token->text);
+
+    LexToken *t = m_lexer->next();
+    if (t && t->type == t_string)
+    {
+        result->right = string_(t);
+    } else if (t) 
+    {
+        m_lexer->pushBack(t);
+        t = nullptr;
+    }
+    free(t);
+
+    if (swallowNext(t_eol)) return result;
+
+    delete result;
+    return nullptr;
+}
+
+Node *Parser::mem(LexToken *token)
 {
     UNUSED(token)
 
-    if (swallowNext(t_eol)) return new Node(nt_stat, token->text);
+    if (swallowNext(t_eol)) return new Node(nt_mem, token->text);
+    return nullptr;
+}
+
+Node *Parser::history(LexToken *token)
+{
+    Node *result = new Node(nt_history, token->text);
+
+    LexToken *t = m_lexer->next();
+    if (t && t->type == t_integer)
+    {
+        result->right = new Node(nt_integer, t->text);
+    } else if (t) 
+    {
+        m_lexer->pushBack(t);
+        t = nullptr;
+    }
+    free(t);
+
+    if (swallowNext(t_eol)) return result;
+
+    delete result;
     return nullptr;
 }
 
@@ -1119,6 +1343,48 @@ Node *Parser::trun(LexToken *token)
     return nullptr;
 }
 
+Node *Parser::jit(LexToken *token) 
+{
+    Node *result = new Node(nt_jit, token->text);
+
+    LexToken *t = m_lexer->next();
+    if (t && t->type == t_identifier)
+    {
+        result->right = new Node(nt_identifier, t->text);
+    } else if (t) 
+    {
+        m_lexer->pushBack(t);
+        t = nullptr;
+    }
+    free(t);
+
+    if (swallowNext(t_eol)) return result;
+    return nullptr;
+}
+
+// PROFILE and TRACE: ON, OFF, a file to write to, or nothing
+Node *Parser::onOffOrFile(LexToken *token, NodeType type) 
+{
+    Node *result = new Node(type, token->text);
+
+    LexToken *t = m_lexer->next();
+    if (t && t->type == t_identifier)
+    {
+        result->right = new Node(nt_identifier, t->text);
+    } else if (t && t->type == t_string)
+    {
+        result->right = string_(t);
+    } else if (t) 
+    {
+        m_lexer->pushBack(t);
+        t = nullptr;
+    }
+    free(t);
+
+    if (swallowNext(t_eol)) return result;
+    return nullptr;
+}
+
 Node *Parser::scnclr(LexToken *token) 
 {
     UNUSED(token)
@@ -2,9 +2,12 @@
 #define _PARSER_HPP_
 
 #include "Lexer.hpp"
+#include "Value.hpp"
 
 #include <vector>
 
+struct CompiledExpression;
+
 enum NodeType {
     nt_unknown, nt_command, nt_lines, nt_statements, nt_statement, nt_newline,
     nt_load, nt_new, nt_stat, nt_bye, nt_scnclr, nt_list, nt_integerrange,
@@ -16,7 +19,9 @@ enum NodeType {
     nt_return, nt_if, nt_then, nt_trun, nt_for, nt_next, nt_step, nt_to, nt_function,
     nt_input, nt_at, nt_open, nt_as, nt_output, nt_close, nt_printfile, nt_inputfile,
     nt_inkey, nt_getkey, nt_data, nt_read, nt_arrayid, nt_idlist, nt_restore, nt_dim,
-    nt_else, nt_using
+    nt_else, nt_using, nt_jit, nt_flush, nt_random, nt_field, nt_get, nt_put, nt_matinput,
+    nt_profile, nt_mem, nt_trace, nt_tron, nt_troff, nt_history,
+    nt_count    // Number of node types; keep last
 };
 
 struct Node {
@@ -25,8 +30,17 @@ struct Node {
 
     string data = "";
 
+    // Result type assigned by TypeInference; vt_null when unknown
+    ValueType valueType = vt_null;
+
+    // Set by LineCompiler once the owning line is hot
+    CompiledExpression *compiled = nullptr;
+
     Node *parent = nullptr;
 
+    // Which statement of its line an nt_statement node is, from 0
+    int position = 0;
+
     Node *left = nullptr;
     Node *right = nullptr;
 
@@ -91,6 +105,8 @@ class Parser {
         Node *load(LexToken *token);
         Node *new_(LexToken *token);
         Node *stat(LexToken *token);
+        Node *mem(LexToken *token);
+        Node *history(LexToken *token);
         Node *bye(LexToken *token);
         Node *scnclr(LexToken *token);
         Node *list(LexToken *token);
@@ -108,6 +124,8 @@ class Parser {
         Node *real(LexToken *token);
         Node *run(LexToken *token);
         Node *trun(LexToken *token);
+        Node *jit(LexToken *token);
+        Node *onOffOrFile(LexToken *token, NodeType type);
         Node *goto_(LexToken *token);
         Node *andExpr(LexToken *token);
         Node *notExpr(LexToken *token);
@@ -125,6 +143,8 @@ class Parser {
         Node *arrayValue(LexToken *token);
         Node *clear(LexToken *token);
         Node *end(LexToken *token);
+        Node *tron(LexToken *token);
+        Node *troff(LexToken *token);
         Node *gosub(LexToken *token);
         Node *return_(LexToken *token);
         Node *if_(LexToken *token);
@@ -136,6 +156,10 @@ class Parser {
         Node *open(LexToken *token);
         Node *for_as(LexToken *token);
         Node *close(LexToken *token);
+        Node *flush(LexToken *token);
+        Node *field(LexToken *token);
+        Node *record(LexToken *token, NodeType type);
+        Node *mat(LexToken *token);
         Node *inkey(LexToken *token);
         Node *getkey(LexToken *token);
         Node *data(LexToken *token);
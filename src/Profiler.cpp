@@ -0,0 +1,117 @@
+#include "Profiler.hpp"
+
+#include <fstream>
+
+Profiler::~Profiler()
+{
+    stop();
+}
+
+void Profiler::start()
+{
+    stop();
+
+    m_line.store(-1, memory_order_relaxed);
+    m_depth.store(0, memory_order_relaxed);
+    m_stacks.clear();
+    m_samples = 0;
+    m_stop = false;
+    m_thread = thread(&Profiler::samplerLoop, this);
+}
+
+void Profiler::stop()
+{
+    if (!m_thread.joinable()) return;
+
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_one();
+    m_thread.join();
+}
+
+void Profiler::call(int lineNum)
+{
+    unsigned version = m_version.load(memory_order_relaxed);
+    m_version.store(version + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    int depth = m_depth.load(memory_order_relaxed);
+    if (depth < MAX_DEPTH) m_frames[depth].store(lineNum, memory_order_relaxed);
+    m_depth.store(depth + 1, memory_order_relaxed);
+
+    m_version.store(version + 2, memory_order_release);
+}
+
+void Profiler::ret()
+{
+    // RETURN without GOSUB, or a GOSUB made before the profiler started
+    int depth = m_depth.load(memory_order_relaxed);
+    if (depth == 0) return;
+
+    unsigned version = m_version.load(memory_order_relaxed);
+    m_version.store(version + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    m_depth.store(depth - 1, memory_order_relaxed);
+
+    m_version.store(version + 2, memory_order_release);
+}
+
+void Profiler::samplerLoop()
+{
+    unique_lock<mutex> lock(m_mutex);
+    while (!m_wake.wait_for(lock, SAMPLE_INTERVAL, [this]() { return m_stop; }))
+    {
+        string stack;
+        if (sample(stack))
+        {
+            m_stacks[stack]++;
+            m_samples++;
+        }
+    }
+}
+
+bool Profiler::sample(string &stack)
+{
+    int frames[MAX_DEPTH];
+
+    // A GOSUB or RETURN is far shorter than a sample, so a few tries will do
+    for (int attempt = 0; attempt < 4; attempt++)
+    {
+        unsigned before = m_version.load(memory_order_acquire);
+        if (before & 1) continue;
+
+        int depth = m_depth.load(memory_order_relaxed);
+        if (depth > MAX_DEPTH) depth = MAX_DEPTH;
+        for (int i = 0; i < depth; i++) frames[i] = m_frames[i].load(memory_order_relaxed);
+        int line = m_line.load(memory_order_relaxed);
+
+        atomic_thread_fence(memory_order_acquire);
+        if (m_version.load(memory_order_relaxed) != before) continue;
+
+        // Nothing has run yet
+        if (line < 0) return false;
+
+        stack = "RUN";
+        for (int i = 0; i < depth; i++) stack += ";GOSUB " + to_string(frames[i]);
+        stack += ";LINE " + to_string(line);
+        return true;
+    }
+
+    return false;
+}
+
+bool Profiler::write(const string &filename) const
+{
+    ofstream out(filename);
+    if (!out) return false;
+
+    for (const pair<const string, uint64_t> &s : m_stacks)
+    {
+        out << s.first << " " << s.second << "\n";
+    }
+
+    return out.good();
+}
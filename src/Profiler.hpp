@@ -0,0 +1,63 @@
+#ifndef _PROFILER_HPP_
+#define _PROFILER_HPP_
+
+#include "main.hpp"
+
+#include <map>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include <condition_variable>
+
+/*
+ * Wall-clock sampling profiler for RUN.  While it's started, a thread
+ * wakes every SAMPLE_INTERVAL and notes the line the program is on and
+ * the GOSUBs it's inside, without stopping the interpreter: the
+ * interpreter only publishes where it is in atomics as it goes (line(),
+ * call(), ret()), and a sample the GOSUB stack changed under is taken
+ * again, seqlock fashion.  Samples are kept as collapsed stacks, one line
+ * per distinct stack, e.g. "RUN;GOSUB 1000;LINE 1030 42", which is what
+ * flamegraph.pl and speedscope read.
+ */
+class Profiler {
+public:
+    ~Profiler();
+
+    // Between start() and stop() samples are taken; start() discards the
+    // last run's, stop() waits for the sampling thread to finish
+    void start();
+    void stop();
+
+    // Called by the interpreter thread only
+    void line(int lineNum) { m_line.store(lineNum, memory_order_relaxed); }
+    void call(int lineNum);
+    void ret();
+
+    // Only once stopped
+    uint64_t samples() const { return m_samples; }
+    bool write(const string &filename) const;
+
+private:
+    static const int MAX_DEPTH = 256;   // Deeper GOSUBs are sampled as the deepest kept
+    const chrono::microseconds SAMPLE_INTERVAL = chrono::microseconds(1000);
+
+    atomic<int> m_line{-1};
+    atomic<int> m_depth{0};
+    atomic<int> m_frames[MAX_DEPTH] = {};
+    atomic<unsigned> m_version{0};      // Odd while call() or ret() is changing the stack
+
+    thread m_thread;
+    mutex m_mutex;
+    condition_variable m_wake;
+    bool m_stop = false;
+
+    // The sampling thread's while it runs
+    map<string, uint64_t> m_stacks;
+    uint64_t m_samples = 0;
+
+    void samplerLoop();
+    bool sample(string &stack);
+};
+
+#endif
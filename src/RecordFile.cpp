@@ -0,0 +1,105 @@
+#include "RecordFile.hpp"
+#include "Counters.hpp"
+#include "Device.hpp"
+
+#include <algorithm>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+RecordFile::RecordFile(const string &filename, int recordLength)
+{
+    m_recordLength = recordLength;
+    m_record.assign(recordLength, ' ');
+    // A stream can't be read or written by record number
+    if (deviceDescriptor(filename) < 0) m_fd = ::open(filename.c_str(), O_RDWR | O_CREAT, 0666);
+}
+
+RecordFile::~RecordFile()
+{
+    close();
+}
+
+void RecordFile::close()
+{
+    if (m_fd >= 0) ::close(m_fd);
+    m_fd = -1;
+}
+
+long long RecordFile::length() const
+{
+    struct stat st;
+    if (m_fd < 0 || fstat(m_fd, &st) != 0) return 0;
+    return st.st_size;
+}
+
+bool RecordFile::setLayout(const vector<int> &widths)
+{
+    int offset = 0;
+    for (int width : widths) offset += width;
+    if (offset > m_recordLength) return false;
+
+    m_offsets.clear();
+    m_widths = widths;
+    offset = 0;
+    for (int width : widths)
+    {
+        m_offsets.push_back(offset);
+        offset += width;
+    }
+    return true;
+}
+
+string RecordFile::field(size_t index) const
+{
+    string s = m_record.substr(m_offsets[index], m_widths[index]);
+    size_t end = s.find_last_not_of(' ');
+    s.erase(end == string::npos ? 0 : end + 1);
+    return s;
+}
+
+void RecordFile::setField(size_t index, const string &s)
+{
+    string padded = s.substr(0, m_widths[index]);
+    padded.resize(m_widths[index], ' ');
+    m_record.replace(m_offsets[index], m_widths[index], padded);
+}
+
+bool RecordFile::get(int record)
+{
+    off_t offset = off_t(record - 1) * m_recordLength;
+    size_t done = 0;
+    while (done < m_record.size())
+    {
+        ssize_t count = ::pread(m_fd, &m_record[done], m_record.size() - done, offset + done);
+        if (count < 0 && errno == EINTR) continue;
+        if (count < 0) return false;
+        if (count == 0) break;
+        done += count;
+    }
+    tally(counters.bytesRead, done);
+
+    // Past the end of the file
+    fill(m_record.begin() + done, m_record.end(), ' ');
+    m_position = record;
+    return true;
+}
+
+bool RecordFile::put(int record)
+{
+    off_t offset = off_t(record - 1) * m_recordLength;
+    size_t done = 0;
+    while (done < m_record.size())
+    {
+        ssize_t count = ::pwrite(m_fd, m_record.data() + done, m_record.size() - done, offset + done);
+        if (count < 0 && errno == EINTR) continue;
+        if (count < 0) return false;
+        done += count;
+    }
+    tally(counters.bytesWritten, done);
+
+    m_position = record;
+    return true;
+}
@@ -0,0 +1,55 @@
+#ifndef _RECORDFILE_HPP_
+#define _RECORDFILE_HPP_
+
+#include "main.hpp"
+
+#include <vector>
+
+/*
+ * A file of fixed-length records for OPEN ... FOR RANDOM.  Records are
+ * numbered from 1 and read and written in place with pread/pwrite, so
+ * updating one record never touches the rest of the file.  FIELD splits a
+ * record into fixed-width fields; GET fills the record buffer and PUT
+ * writes it back.  Records beyond the end of the file read as spaces.
+ */
+class RecordFile {
+public:
+    RecordFile(const string &filename, int recordLength);
+    ~RecordFile();
+
+    bool isOpen() const { return m_fd >= 0; }
+    int recordLength() const { return m_recordLength; }
+
+    // The last record read or written (LOC), and the file size in bytes (LOF)
+    int position() const { return m_position; }
+    long long length() const;
+
+    // False when the widths add up to more than the record length
+    bool setLayout(const vector<int> &widths);
+    size_t fieldCount() const { return m_offsets.size(); }
+
+    // A field with its padding removed, and a value padded or cut to fit
+    string field(size_t index) const;
+    void setField(size_t index, const string &s);
+    int fieldWidth(size_t index) const { return m_widths[index]; }
+
+    bool get(int record);
+    bool put(int record);
+    void close();
+
+    // Bytes of record buffer and layout held, for MEM
+    size_t memoryUsed() const
+    {
+        return m_record.capacity() + (m_offsets.capacity() + m_widths.capacity()) * sizeof(int);
+    }
+
+private:
+    int m_fd = -1;
+    int m_recordLength;
+    int m_position = 0;
+    string m_record;
+    vector<int> m_offsets;
+    vector<int> m_widths;
+};
+
+#endif
@@ -0,0 +1,446 @@
+#include "Runtime.hpp"
+
+#include <iostream>
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+
+Runtime::Runtime(Console *console)
+{
+    this->console = console;
+    srand(time(NULL));
+}
+
+Runtime::~Runtime()
+{
+    for (map<int, RuntimeFile *>::iterator it = m_files.begin(); it != m_files.end(); it++)
+    {
+        delete it->second;
+    }
+}
+
+void Runtime::error(const string &msg)
+{
+    // Not flushAll(), which can itself end up here
+    for (map<int, RuntimeFile *>::iterator it = m_files.begin(); it != m_files.end(); it++)
+    {
+        if (it->second->out) it->second->out->flush();
+    }
+
+    console->addText("Runtime error at line " + to_string(currLine));
+    console->addText(msg);
+    console->terminate();
+    exit(1);
+}
+
+const Value &Runtime::checked(const Value &v)
+{
+    if (v.isNull()) error("Type mismatch");
+    return v;
+}
+
+void Runtime::checkAssign(const Value &v, bool stringVariable)
+{
+    if ((v.isString() && !stringVariable) || (v.isNumeric() && stringVariable)) error("Type mismatch");
+}
+
+bool Runtime::greaterEqual(Value v1, Value v2)
+{
+    return v1.isGreaterThan(v2) || v1.equals(v2);
+}
+
+bool Runtime::lessEqual(Value v1, Value v2)
+{
+    return v1.isLessThan(v2) || v1.equals(v2);
+}
+
+void Runtime::gosub(int returnPoint)
+{
+    m_gosub.push_back(returnPoint);
+}
+
+int Runtime::return_()
+{
+    if (m_gosub.empty()) error("RETURN without GOSUB error");
+
+    int result = m_gosub.back();
+    m_gosub.pop_back();
+    return result;
+}
+
+int Runtime::for_(const string &var, const Value &from, const Value &to, int resumePoint)
+{
+    if (!from.isInteger()) error("Type mismatch in FOR");
+
+    m_for[var].resumePoint = resumePoint;
+    m_for[var].endIndex = to.integer();
+    m_forStack.push_back(var);
+    return from.integer();
+}
+
+RuntimeFor &Runtime::next(const string &var)
+{
+    map<string, RuntimeFor>::iterator it = m_for.find(var);
+    if (var == "" || it == m_for.end()) error("NEXT without matching FOR");
+
+    return it->second;
+}
+
+string Runtime::innerFor() const
+{
+    return (m_forStack.empty() ? "" : m_forStack.back());
+}
+
+void Runtime::endFor(const string &var)
+{
+    vector<string>::iterator it = find(m_forStack.begin(), m_forStack.end(), var);
+    if (it != m_forStack.end()) m_forStack.erase(it);
+    m_for.erase(var);
+}
+
+void Runtime::data(const Value &v)
+{
+    m_data.push_back(v);
+}
+
+void Runtime::restore()
+{
+    m_dataIndex = 0;
+}
+
+Value Runtime::read()
+{
+    if (m_dataIndex >= m_data.size()) error("Out of DATA");
+
+    return m_data[m_dataIndex++];
+}
+
+string Runtime::key(const char *id, initializer_list<Value> indices)
+{
+    string result = id;
+    for (const Value &v : indices)
+    {
+        result += "__" + v.string();
+    }
+    transform(result.begin(), result.end(), result.begin(),
+    [](unsigned char c){ return tolower(c); });
+    return result;
+}
+
+Value Runtime::element(const string &key) const
+{
+    map<string, Value>::const_iterator it = m_elements.find(key);
+    if (it == m_elements.end()) return Value(0);
+
+    return it->second;
+}
+
+void Runtime::setElement(const string &key, const Value &v)
+{
+    m_elements[key] = v;
+}
+
+void Runtime::clear()
+{
+    m_elements.clear();
+}
+
+void Runtime::open(const string &file, int number, RuntimeAccess access, int recordLength, bool async)
+{
+    if (m_files.find(number) != m_files.end())
+    {
+        error("File number " + to_string(number) + " already in use.");
+    }
+    if (recordLength < 1) error("Invalid record length " + to_string(recordLength));
+
+    RuntimeFile *f = new RuntimeFile();
+    f->access = access;
+    if (access == ra_input) f->in = new FieldReader(file);
+    else if (access == ra_output) f->out = new FieldWriter(file, m_flushInterval, async);
+    else f->records = new RecordFile(file, recordLength);
+    if ((f->in && !f->in->isOpen()) || (f->out && !f->out->isOpen()) || (f->records && !f->records->isOpen()))
+    {
+        delete f;
+        error("Unable to open file \"" + file + "\"");
+    }
+
+    m_files[number] = f;
+}
+
+void Runtime::close(int number)
+{
+    map<int, RuntimeFile *>::iterator it = m_files.find(number);
+    if (it == m_files.end()) error("File number " + to_string(number) + " has not been opened.");
+
+    if (it->second->out && !it->second->out->close()) error("Error writing to file #" + to_string(number));
+    delete it->second;
+    m_files.erase(it);
+}
+
+RuntimeFile *Runtime::file(int number)
+{
+    map<int, RuntimeFile *>::iterator it = m_files.find(number);
+    if (it == m_files.end()) error("File number " + to_string(number) + " undefined");
+
+    return it->second;
+}
+
+void Runtime::printFile(int number, const string &s, bool append)
+{
+    RuntimeFile *f = file(number);
+    if (!f->out) error("Cannot write to a file that was opened for " + f->accessName() + " access");
+
+    if (!f->out->write(append ? s : s + '\n')) error("Error writing to file #" + to_string(number));
+}
+
+void Runtime::flush(int number)
+{
+    RuntimeFile *f = file(number);
+    if (!f->out) error("Cannot flush a file that was opened for " + f->accessName() + " access");
+
+    if (!f->out->flush()) error("Error writing to file #" + to_string(number));
+}
+
+void Runtime::flushAll()
+{
+    for (map<int, RuntimeFile *>::iterator it = m_files.begin(); it != m_files.end(); it++)
+    {
+        if (it->second->out && !it->second->out->flush()) error("Error writing to file #" + to_string(it->first));
+    }
+}
+
+// Before waiting for the user: the wait may well outlast the flush interval
+void Runtime::flushTimed()
+{
+    for (map<int, RuntimeFile *>::iterator it = m_files.begin(); it != m_files.end(); it++)
+    {
+        if (it->second->out && !it->second->out->timedFlush(true)) error("Error writing to file #" + to_string(it->first));
+    }
+}
+
+void Runtime::flushEvery(int ms)
+{
+    m_flushInterval = ms;
+    for (map<int, RuntimeFile *>::iterator it = m_files.begin(); it != m_files.end(); it++)
+    {
+        if (it->second->out) it->second->out->setFlushInterval(ms);
+    }
+}
+
+Value Runtime::inputFile(int number, bool stringVariable)
+{
+    RuntimeFile *f = file(number);
+    if (!f->in) error("Cannot read from a file that was opened for " + f->accessName() + " access");
+
+    string s;
+    if (!f->in->next(s)) error("Input past end of file");
+
+    if (stringVariable) return Value(s);
+    return checked(FieldReader::number(s));
+}
+
+void Runtime::matInput(int number, const char *id, bool stringVariable)
+{
+    RuntimeFile *f = file(number);
+    if (!f->in) error("Cannot read from a file that was opened for " + f->accessName() + " access");
+
+    vector<Value> values;
+    string bad;
+    if (!FieldReader::parseAll(f->in->rest(), stringVariable, values, bad)) error("Type mismatch: \"" + bad + "\"");
+
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        m_elements[key(id, {Value(int(i + 1))})] = move(values[i]);
+    }
+    f->matCount = values.size();
+}
+
+RuntimeFile *Runtime::randomFile(int number, const string &statement)
+{
+    RuntimeFile *f = file(number);
+    if (!f->records) error(statement + " needs a file opened for RANDOM access");
+    return f;
+}
+
+int Runtime::recordNumber(RuntimeFile *f, const Value &record)
+{
+    if (record.isNull()) return f->records->position() + 1;
+    if (!record.isInteger() || record.integer() < 1) error("Bad record number: \"" + record.string() + "\"");
+    return record.integer();
+}
+
+void Runtime::field(int number, initializer_list<int> widths)
+{
+    RuntimeFile *f = randomFile(number, "FIELD");
+    if (!f->records->setLayout(widths)) error("FIELD is longer than the record length of file #" + to_string(number));
+}
+
+void Runtime::get(int number, const Value &record)
+{
+    RuntimeFile *f = randomFile(number, "GET");
+    if (!f->records->get(recordNumber(f, record))) error("Error reading from file #" + to_string(number));
+}
+
+void Runtime::put(int number, const Value &record)
+{
+    RuntimeFile *f = randomFile(number, "PUT");
+    if (!f->records->put(recordNumber(f, record))) error("Error writing to file #" + to_string(number));
+}
+
+// A field of the record last read by GET; false if FIELD didn't define it
+bool Runtime::fieldValue(int number, size_t index, bool stringVariable, Value &v)
+{
+    RuntimeFile *f = randomFile(number, "GET");
+    if (index >= f->records->fieldCount()) return false;
+
+    string s = f->records->field(index);
+    if (stringVariable) v = Value(s);
+    else if (s.empty()) v = Value(0);
+    else v = checked(FieldReader::number(s));
+    return true;
+}
+
+void Runtime::setField(int number, size_t index, const Value &v)
+{
+    RuntimeFile *f = randomFile(number, "PUT");
+    if (index >= f->records->fieldCount()) return;
+
+    // As System::put: text is cut to fit, a number must fit whole
+    string s = v.string();
+    if (v.isNumeric() && int(s.size()) > f->records->fieldWidth(index)) error("Field overflow");
+    f->records->setField(index, s);
+}
+
+Value Runtime::input(const string &prompt, bool stringVariable)
+{
+    flushTimed();
+    if (stringVariable) return Value(console->inputString(prompt));
+    return Value(console->inputNumber(prompt));
+}
+
+Value Runtime::getKey()
+{
+    flushTimed();
+
+    string s = "";
+    int index = 0;
+    while (index < 50 && s == "")
+    {
+        s = console->getKey();
+        index++;
+    }
+    if (s == "return") s = string(1, '\r');
+
+    return Value(s);
+}
+
+Value Runtime::inkey()
+{
+    return Value(console->getKey());
+}
+
+Value Runtime::function(const char *name, const Value &param)
+{
+    string ltext = name;
+
+    if (ltext == "tab") return tab(param);
+    if (ltext == "int") return intFunc(param);
+    if (ltext == "rnd") return rnd(param);
+    if (ltext == "str$") return strFunc(param);
+    if (ltext == "val") return valFunc(param);
+    if (ltext == "chr$") return chrFunc(param);
+    if (ltext == "eof") return eofFunc(param);
+    if (ltext == "lof") return lofFunc(param);
+    if (ltext == "loc") return locFunc(param);
+    if (ltext == "num") return numFunc(param);
+    else return Value();
+}
+
+Value Runtime::eofFunc(const Value &v)
+{
+    if (!v.isInteger()) error("Type mismatch in call to EOF()");
+
+    RuntimeFile *f = file(v.integer());
+    if (!f->in) error("EOF() needs a file opened for INPUT access");
+    return Value(f->in->eof());
+}
+
+Value Runtime::lofFunc(const Value &v)
+{
+    if (!v.isInteger()) error("Type mismatch in call to LOF()");
+
+    return Value(int(randomFile(v.integer(), "LOF()")->records->length()));
+}
+
+Value Runtime::locFunc(const Value &v)
+{
+    if (!v.isInteger()) error("Type mismatch in call to LOC()");
+
+    return Value(randomFile(v.integer(), "LOC()")->records->position());
+}
+
+Value Runtime::numFunc(const Value &v)
+{
+    if (!v.isInteger()) error("Type mismatch in call to NUM()");
+
+    RuntimeFile *f = file(v.integer());
+    if (!f->in) error("NUM() needs a file opened for INPUT access");
+    return Value(f->matCount);
+}
+
+Value Runtime::tab(const Value &v)
+{
+    if (!v.isInteger()) error("Type mismatch in call to TAB()");
+
+    CursorPos cpos = console->getCursorPos();
+    cpos.col = v.integer();
+    console->setCursorPos(cpos);
+    return string("");
+}
+
+Value Runtime::intFunc(const Value &v)
+{
+    if (v.isString() && isFloat(v.string()))
+    {
+        return Value(int(stof(v.string())));
+    }
+    if (!v.isNumeric()) error("Type mismatch in call to INT()");
+
+    return Value(int(v.real()));
+}
+
+Value Runtime::strFunc(const Value &v)
+{
+    if (!v.isNumeric() && !v.isString()) error("Type mismatch in call to STR$()");
+
+    return Value(v.string());
+}
+
+Value Runtime::chrFunc(const Value &v)
+{
+    if (v.isInteger() && v.integer() > -1 && v.integer() < 256)
+        return Value("" + string(1, static_cast<char>(v.integer())));
+    else return Value("");
+}
+
+Value Runtime::valFunc(const Value &v)
+{
+    if (v.isNumeric()) return v;
+    if (isInteger(v.string())) return Value(stoi(v.string()));
+    if (isFloat(v.string())) return Value(stof(v.string()));
+    else return Value(0);
+}
+
+Value Runtime::rnd(const Value &v)
+{
+    if (!v.isInteger()) error("Type mismatch in call to RND()");
+
+    if (v.integer() == 0)
+    {
+        return Value(float(rand())/float(RAND_MAX));
+    } else
+    {
+        int n = rand();
+        return Value((n % v.integer()) + 1);
+    }
+}
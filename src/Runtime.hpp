@@ -0,0 +1,128 @@
+#ifndef _RUNTIME_HPP_
+#define _RUNTIME_HPP_
+
+#include "Console.hpp"
+#include "FieldReader.hpp"
+#include "FieldWriter.hpp"
+#include "RecordFile.hpp"
+#include "Value.hpp"
+
+#include <map>
+#include <vector>
+#include <initializer_list>
+#include <fstream>
+
+struct RuntimeFor {
+    int resumePoint;
+    int endIndex;
+};
+
+enum RuntimeAccess { ra_input, ra_output, ra_random };
+
+struct RuntimeFile {
+    RuntimeAccess access;
+    FieldReader *in = nullptr;
+    FieldWriter *out = nullptr;
+    RecordFile *records = nullptr;
+    int matCount = 0;
+
+    ~RuntimeFile() { delete in; delete out; delete records; }
+
+    string accessName() const
+    {
+        if (access == ra_input) return "INPUT";
+        if (access == ra_output) return "OUTPUT";
+        return "RANDOM";
+    }
+};
+
+/*
+ * Support library for programs translated by kbasic-aot.  Generated code
+ * keeps scalars in C++ locals and does its own control flow; everything
+ * else (arrays, DATA, the GOSUB and FOR stacks, files and the built-in
+ * functions) lives here, with the same behaviour and error messages as
+ * the interpreter in System.
+ */
+class Runtime {
+public:
+    Runtime(Console *console);
+    ~Runtime();
+
+    Console *console;
+    int currLine = 0;
+
+    [[noreturn]] void error(const string &msg);
+    const Value &checked(const Value &v);
+    void checkAssign(const Value &v, bool stringVariable);
+
+    static bool greaterEqual(Value v1, Value v2);
+    static bool lessEqual(Value v1, Value v2);
+
+    void gosub(int returnPoint);
+    int return_();
+
+    int for_(const string &var, const Value &from, const Value &to, int resumePoint);
+    RuntimeFor &next(const string &var);
+    string innerFor() const;
+    void endFor(const string &var);
+
+    void data(const Value &v);
+    void restore();
+    Value read();
+
+    static string key(const char *id, initializer_list<Value> indices);
+    Value element(const string &key) const;
+    void setElement(const string &key, const Value &v);
+    void clear();
+
+    void open(const string &file, int number, RuntimeAccess access, int recordLength = 128, bool async = false);
+    void close(int number);
+    void printFile(int number, const string &s, bool append);
+    void flush(int number);
+    void flushAll();
+    void flushTimed();
+    void flushEvery(int ms);
+    Value inputFile(int number, bool stringVariable);
+    void matInput(int number, const char *id, bool stringVariable);
+
+    void field(int number, initializer_list<int> widths);
+    void get(int number, const Value &record);
+    void put(int number, const Value &record);
+    bool fieldValue(int number, size_t index, bool stringVariable, Value &v);
+    void setField(int number, size_t index, const Value &v);
+
+    Value input(const string &prompt, bool stringVariable);
+    Value getKey();
+    Value inkey();
+
+    Value function(const char *name, const Value &param);
+
+private:
+    vector<int> m_gosub;
+    map<string, RuntimeFor> m_for;
+    vector<string> m_forStack;
+
+    vector<Value> m_data;
+    size_t m_dataIndex = 0;
+
+    map<string, Value> m_elements;
+    map<int, RuntimeFile *> m_files;
+    int m_flushInterval = 1000;
+
+    RuntimeFile *file(int number);
+    RuntimeFile *randomFile(int number, const string &statement);
+    int recordNumber(RuntimeFile *f, const Value &record);
+
+    Value tab(const Value &v);
+    Value intFunc(const Value &v);
+    Value strFunc(const Value &v);
+    Value rnd(const Value &v);
+    Value valFunc(const Value &v);
+    Value chrFunc(const Value &v);
+    Value eofFunc(const Value &v);
+    Value lofFunc(const Value &v);
+    Value locFunc(const Value &v);
+    Value numFunc(const Value &v);
+};
+
+#endif
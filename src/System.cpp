@@ -8,6 +8,7 @@
 #include <climits>
 #include <cmath>
 #include <algorithm>
+#include <cstring>
 #include <ctime>
 #include <cstdlib>
 #include <iomanip>
@@ -16,16 +17,12 @@
 
 System *core = new System();
 
-System::System() {
+System::System() : m_lineCompiler(this) {
     srand(time(NULL));
 }
 
 System::~System()
 {
-    for (map<int, FileAccess*>::iterator it = m_openFiles.begin(); it != m_openFiles.end(); it++)
-    {
-        free(it->second);
-    }
 }
 
 bool System::checkNext(Lexer *l, TokenType type)
@@ -95,7 +92,12 @@ void System::loadCodeLine(string line)
     
     if (is_number(results[0])) {
         if (results.size() == 1) {
-            m_program.erase(stoi(results[0]));
+            map<int, ProgramLine *>::iterator it = m_program.find(stoi(results[0]));
+            if (it != m_program.end())
+            {
+                m_memory.remove(mc_program, lineBytes(it->second));
+                m_program.erase(it);
+            }
         } else {
             ProgramLine *p = new ProgramLine();
             p->lineNum = stoi(results[0]);
@@ -114,6 +116,9 @@ void System::loadCodeLine(string line)
                 free(p);
             } else
             {
+                map<int, ProgramLine *>::iterator it = m_program.find(p->lineNum);
+                if (it != m_program.end()) m_memory.remove(mc_program, lineBytes(it->second));
+                m_memory.add(mc_program, lineBytes(p));
                 m_program[p->lineNum] = p;
             }
         }
@@ -129,6 +134,8 @@ void System::execute(Node *node)
     if (node->type == nt_load) load(node);
     else if (node->type == nt_new) new_(node);
     else if (node->type == nt_stat) stat(node);
+    else if (node->type == nt_mem) mem(node);
+    else if (node->type == nt_history) history(node);
     else if (node->type == nt_bye) bye(node);
     else if (node->type == nt_list) list(node);
     else if (node->type == nt_files) files(node);
@@ -137,6 +144,13 @@ void System::execute(Node *node)
     else if (node->type == nt_line) line(node);
     else if (node->type == nt_run) run(node);
     else if (node->type == nt_trun) trun(node);
+    else if (node->type == nt_jit) jit(node);
+    else if (node->type == nt_profile) profile(node);
+    else if (node->type == nt_trace) trace(node);
+
+    // Whatever stopped the program - END, an error, a break - its output
+    // files should be complete on disk when we return to the prompt
+    flushFiles();
 
     if (m_errors.size() > 0)
     {
@@ -145,11 +159,137 @@ void System::execute(Node *node)
         {
             m_output->addText(*it);
         }
+        if (currLine != NO_LINE_NUM) showHistory(ERROR_HISTORY);
     }
 
     executionStatus = ex_done;
 }
 
+#ifdef KBASIC_THREADED_DISPATCH
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+
+// Direct-threaded version of the loop below.  Each handler ends with its
+// own copy of NEXT_STATEMENT, so the indirect jump to the following
+// statement's handler is made from a different place for every statement
+// type and the branch predictor can learn the sequences separately.
+// IF and ELSE run their nested statement through statement() as before.
+void System::statements(Node *node) 
+{
+    static void *handlers[nt_count] = { nullptr };
+    if (!handlers[0])
+    {
+        for (int i = 0; i < nt_count; i++) handlers[i] = &&op_none;
+        handlers[nt_print] = &&op_print;
+        handlers[nt_scnclr] = &&op_scnclr;
+        handlers[nt_assign] = &&op_assign;
+        handlers[nt_clear] = &&op_clear;
+        handlers[nt_return] = &&op_return;
+        handlers[nt_if] = &&op_if;
+        handlers[nt_else] = &&op_else;
+        handlers[nt_for] = &&op_for;
+        handlers[nt_next] = &&op_next;
+        handlers[nt_input] = &&op_input;
+        handlers[nt_open] = &&op_open;
+        handlers[nt_close] = &&op_close;
+        handlers[nt_flush] = &&op_flush;
+        handlers[nt_field] = &&op_field;
+        handlers[nt_get] = &&op_get;
+        handlers[nt_put] = &&op_put;
+        handlers[nt_matinput] = &&op_matinput;
+        handlers[nt_printfile] = &&op_printfile;
+        handlers[nt_inputfile] = &&op_inputfile;
+        handlers[nt_getkey] = &&op_getkey;
+        handlers[nt_read] = &&op_read;
+        handlers[nt_restore] = &&op_restore;
+        handlers[nt_goto] = &&op_goto;
+        handlers[nt_gosub] = &&op_gosub;
+        handlers[nt_end] = &&op_end;
+        handlers[nt_tron] = &&op_tron;
+        handlers[nt_troff] = &&op_troff;
+    }
+
+    currNode = node;
+    continueStatements = true;
+    ifState = ifs_none;
+    triggerElse = false;
+
+// The checks statement() makes before running a statement
+#define DISPATCH() \
+    do { \
+        if (!currNode || loopResult == l_end) return; \
+        continueStatements = true; \
+        if (ifState == ifs_yes && currNode->left->type == nt_else) \
+        { \
+            ifState = ifs_none; \
+            continueStatements = false; \
+            return; \
+        } else if (ifState == ifs_no && currNode->left->type != nt_else && triggerElse) \
+        { \
+            currNode = currNode->right; \
+            goto skip; \
+        } \
+        remember(currNode); \
+        m_counters.statements[currNode->left->type]++; \
+        goto *handlers[currNode->left->type]; \
+    } while (0)
+
+// ...and the ones it and the loop make afterwards
+#define NEXT_STATEMENT() \
+    do { \
+        if (loopResult == l_end || loopResult == l_escape) \
+        { \
+            m_output->addText("Break"); \
+            continueStatements = false; \
+            return; \
+        } \
+        if (!continueStatements) return; \
+        if (currNode) currNode = currNode->right; \
+        if (m_errors.size() > 0) return; \
+        DISPATCH(); \
+    } while (0)
+
+skip:
+    DISPATCH();
+
+op_print: print(currNode->left); NEXT_STATEMENT();
+op_scnclr: scnclr(currNode->left); NEXT_STATEMENT();
+op_assign: assign(currNode->left); NEXT_STATEMENT();
+op_clear: clear(currNode->left); NEXT_STATEMENT();
+op_return: return_(currNode->left); NEXT_STATEMENT();
+op_if: if_(currNode->left); NEXT_STATEMENT();
+op_else: else_(currNode->left); NEXT_STATEMENT();
+op_for: for_(currNode->left); NEXT_STATEMENT();
+op_next: next(currNode->left); NEXT_STATEMENT();
+op_input: input(currNode->left); NEXT_STATEMENT();
+op_open: open(currNode->left); NEXT_STATEMENT();
+op_close: close(currNode->left); NEXT_STATEMENT();
+op_flush: flush(currNode->left); NEXT_STATEMENT();
+op_field: field(currNode->left); NEXT_STATEMENT();
+op_get: get(currNode->left); NEXT_STATEMENT();
+op_put: put(currNode->left); NEXT_STATEMENT();
+op_matinput: matInput(currNode->left); NEXT_STATEMENT();
+op_printfile: printfile(currNode->left); NEXT_STATEMENT();
+op_inputfile: inputfile(currNode->left); NEXT_STATEMENT();
+op_getkey: getkey(currNode->left); NEXT_STATEMENT();
+op_read: read(currNode->left); NEXT_STATEMENT();
+op_restore: restore(currNode->left); NEXT_STATEMENT();
+op_tron: m_tron = true; NEXT_STATEMENT();
+op_troff: m_tron = false; NEXT_STATEMENT();
+op_none: NEXT_STATEMENT();
+op_goto: goto_(currNode->left); return;
+op_gosub: gosub(currNode->left); return;
+op_end: setLoopResult(l_end); return;
+
+#undef NEXT_STATEMENT
+#undef DISPATCH
+}
+
+#pragma GCC diagnostic pop
+
+#else
+
 void System::statements(Node *node) 
 {
     currNode = node;
@@ -176,6 +316,8 @@ void System::statements(Node *node)
     }
 }
 
+#endif
+
 bool System::statement(Node *node) 
 {
     continueStatements = true;
@@ -191,39 +333,11 @@ bool System::statement(Node *node)
         return true;
     }
 
-    if      (node->left->type == nt_print) print(node->left);
-    else if (node->left->type == nt_scnclr) scnclr(node->left);
-    else if (node->left->type == nt_assign) assign(node->left); 
-    else if (node->left->type == nt_clear) clear(node->left);
-    else if (node->left->type == nt_return) return_(node->left);
-    else if (node->left->type == nt_if) if_(node->left);
-    else if (node->left->type == nt_else) else_(node->left);
-    else if (node->left->type == nt_for) for_(node->left);
-    else if (node->left->type == nt_next) next(node->left);
-    else if (node->left->type == nt_input) input(node->left);
-    else if (node->left->type == nt_open) open(node->left);
-    else if (node->left->type == nt_close) close(node->left);
-    else if (node->left->type == nt_printfile) printfile(node->left);
-    else if (node->left->type == nt_inputfile) inputfile(node->left);
-    else if (node->left->type == nt_getkey) getkey(node->left);
-    else if (node->left->type == nt_data) data(node->left);
-    else if (node->left->type == nt_read) read(node->left);
-    else if (node->left->type == nt_restore) restore(node->left);
-    else if (node->left->type == nt_goto) 
-    {
-        goto_(node->left);
-        return false;
-    }
-    else if (node->left->type == nt_gosub) 
-    {
-        gosub(node->left);
-        return false;
-    }
-    else if (node->left->type == nt_end) 
-    {
-        loopResult = l_end;
-        return false;
-    }
+    // IF and ELSE run their nested statement through here as well; that's
+    // part of the statement that's already been recorded
+    if (node == currNode) remember(node);
+
+    if (!dispatch(node->left)) return false;
 
     if (loopResult == l_end || loopResult == l_escape) 
     {
@@ -234,6 +348,54 @@ bool System::statement(Node *node)
     return continueStatements;
 }
 
+// Runs one statement; false means it transferred control (GOTO, GOSUB, END)
+bool System::dispatch(Node *node)
+{
+    m_counters.statements[node->type]++;
+
+    switch (node->type)
+    {
+        case nt_print: print(node); break;
+        case nt_scnclr: scnclr(node); break;
+        case nt_assign: assign(node); break;
+        case nt_clear: clear(node); break;
+        case nt_return: return_(node); break;
+        case nt_if: if_(node); break;
+        case nt_else: else_(node); break;
+        case nt_for: for_(node); break;
+        case nt_next: next(node); break;
+        case nt_input: input(node); break;
+        case nt_open: open(node); break;
+        case nt_close: close(node); break;
+        case nt_flush: flush(node); break;
+        case nt_field: field(node); break;
+        case nt_get: get(node); break;
+        case nt_put: put(node); break;
+        case nt_matinput: matInput(node); break;
+        case nt_printfile: printfile(node); break;
+        case nt_inputfile: inputfile(node); break;
+        case nt_getkey: getkey(node); break;
+        case nt_data: data(node); break;
+        case nt_read: read(node); break;
+        case nt_restore: restore(node); break;
+        case nt_tron: m_tron = true; break;
+        case nt_troff: m_tron = false; break;
+        case nt_goto:
+            goto_(node);
+            return false;
+        case nt_gosub:
+            gosub(node);
+            return false;
+        case nt_end:
+            setLoopResult(l_end);
+            return false;
+        default:
+            break;
+    }
+
+    return true;
+}
+
 void System::else_(Node *node)
 {
     if (triggerElse)
@@ -247,6 +409,7 @@ void System::else_(Node *node)
 void System::if_(Node *node)
 {
     Value v = expression(node->left);
+    m_counters.branches++;
     ifState = (v.boolean() ? ifs_yes : ifs_no );
     triggerElse = !v.boolean();
     continueStatements = statement(node->right);
@@ -257,6 +420,10 @@ void System::clear(Node *node)
     UNUSED(node)
 
     m_variables.clear();
+    m_variablesGeneration++;
+    m_memory.set(mc_variables, 0);
+    m_memory.set(mc_arrays, 0);
+    m_memory.set(mc_strings, 0);
 }
 
 void System::getkey(Node *node) 
@@ -265,15 +432,11 @@ void System::getkey(Node *node)
 
     inAssign = true;
 
-    waitForClearKeyboard();
-
-    string s = "";
-    int index = 0;
-    while (index < 50 && s == "")
+    string s;
+    flushTimedFiles(true);
     {
-        singleLoop();
-        s = m_output->getKey();
-        index++;
+        TraceSpan span("GETKEY");
+        s = m_output->waitForKey(GETKEY_TIMEOUT);
     }
     if (s == "return") s = string(1, '\r');
 
@@ -290,13 +453,14 @@ void System::assign(Node *node)
     Value v;
     if (node->left->type == nt_inkey)
     {
-        waitForClearKeyboard();
         v = Value(m_output->getKey());
     } else
     {
         v = expression(node->left);
-        if ((v.isString() && (id.size() == 1 || id.substr(id.size() - 1, 1) != "$")) ||
-            (v.isNumeric() && (id.size() > 1 && id.substr(id.size() - 1, 1) == "$")))
+        // TypeInference marks assignments it has already proven type-safe
+        if (node->valueType == vt_null && 
+            ((v.isString() && (id.size() == 1 || id.substr(id.size() - 1, 1) != "$")) ||
+            (v.isNumeric() && (id.size() > 1 && id.substr(id.size() - 1, 1) == "$"))))
         {
             m_errors.push_back("Type mismatch");
             return;
@@ -320,6 +484,7 @@ void System::read(Node *node)
 
         Value v = m_dataStack.front();
         m_dataStack.pop();
+        m_memory.remove(mc_data, sizeof(Value) + v.heapBytes());
         setVariable(currNode->left, v);
         currNode = currNode->right;
     }
@@ -336,27 +501,112 @@ void System::data(Node *node)
 void System::close(Node *node) 
 {
     int number = stoi(node->left->text);
+    TraceSpan span("CLOSE", number);
 
-    map<int, FileAccess *>::iterator it = m_openFiles.find(number);
-    if (it == m_openFiles.end())
+    FileAccess *f = m_openFiles.find(number);
+    if (!f)
     {
         m_errors.push_back("File number " + to_string(number) + " has not been opened.");
         return;
     }
 
-    if (it->second->accessMode == am_output) dynamic_cast<ofstream *>(it->second->stream)->close();
-    if (it->second->accessMode == am_input) dynamic_cast<ifstream *>(it->second->stream)->close();
+    // Waits for an ASYNC file's I/O thread to write everything out
+    if (f->writer && !f->writer->close()) writeFailed(f);
+
+    m_openFiles.erase(number);
+    countFileMemory();
+}
+
+// The open file with this number, or nullptr after reporting that there isn't one
+FileAccess *System::file(int number)
+{
+    FileAccess *f = m_openFiles.find(number);
+    if (!f) m_errors.push_back("File number " + to_string(number) + " undefined");
+    return f;
+}
+
+void System::flush(Node *node)
+{
+    if (node->right)
+    {
+        string mode = node->right->text;
+        transform(mode.begin(), mode.end(), mode.begin(), [](unsigned char c){ return tolower(c); });
+        if (mode != "every")
+        {
+            m_errors.push_back("Expected # or EVERY; found \"" + node->right->text + "\"");
+            return;
+        }
+
+        m_flushInterval = stoi(node->left->text);
+        m_openFiles.forEach([this](FileAccess *f) {
+            if (f->writer) f->writer->setFlushInterval(m_flushInterval);
+        });
+        return;
+    }
+
+    if (!node->left)
+    {
+        flushFiles();
+        return;
+    }
+
+    int number = stoi(node->left->text);
+    TraceSpan span("FLUSH", number);
+    FileAccess *f = file(number);
+    if (!f) return;
+    if (f->accessMode != am_output)
+    {
+        m_errors.push_back("Cannot flush a file that was opened for " + accessName(f->accessMode) + " access");
+        return;
+    }
+
+    if (!f->writer->flush()) writeFailed(f);
+}
+
+void System::flushFiles()
+{
+    m_openFiles.forEach([this](FileAccess *f) {
+        if (f->writer && !f->writer->flush() && !f->failureReported) writeFailed(f);
+    });
+}
+
+// Writes out files whose flush interval has passed; force does every file
+// with an interval, before a wait that may well outlast it
+void System::flushTimedFiles(bool force)
+{
+    m_openFiles.forEach([this, force](FileAccess *f) {
+        if (f->writer && !f->writer->timedFlush(force) && !f->failureReported) writeFailed(f);
+    });
+}
+
+// Reading the clock every line would cost more than the line, so timed
+// flushes are looked for every so many lines and branches; counting
+// branches catches a loop that never leaves its line
+void System::stepTowardsFlush()
+{
+    if (++m_flushCheck < FLUSH_CHECK_STEPS) return;
+
+    m_flushCheck = 0;
+    flushTimedFiles(false);
+}
 
-    free(it->second);
-    m_openFiles.erase(it);
+void System::writeFailed(FileAccess *f)
+{
+    m_errors.push_back("Error writing to file #" + to_string(f->number));
+    f->failureReported = true;
 }
 
 void System::open(Node *node) 
 {
     string file = node->left->text;
     int number = stoi(node->right->right->text);
+    TraceSpan span("OPEN", number);
 
-    if (m_openFiles.find(number) != m_openFiles.end())
+    if (!FileTable::inRange(number))
+    {
+        m_errors.push_back("File number " + to_string(number) + " out of range");
+        return;
+    } else if (m_openFiles.find(number))
     {
         m_errors.push_back("File number " + to_string(number) + " already in use.");
         return;
@@ -364,61 +614,215 @@ void System::open(Node *node)
 
     AccessMode accessMode = am_output;
     if (node->right->left->type == nt_input) accessMode = am_input;
+    if (node->right->left->type == nt_random) accessMode = am_random;
+
+    int recordLength = DEFAULT_RECORD_LENGTH;
+    if (node->right->left->left) recordLength = stoi(node->right->left->left->text);
+    if (recordLength < 1)
+    {
+        m_errors.push_back("Invalid record length " + to_string(recordLength));
+        return;
+    }
 
-    FileAccess *f = new FileAccess(file, number, accessMode);
+    bool async = (node->right->left->data == "async");
+    unique_ptr<FileAccess> f(new FileAccess(file, number, accessMode, m_flushInterval, recordLength, async));
     if (!f->isOpen())
     {
         m_errors.push_back("Unable to open file \"" + file + "\"");
         return;
     }
 
-    m_openFiles[number] = f;
+    m_openFiles.insert(move(f));
+    countFileMemory();
 }
 
-void System::inputfile(Node *node) 
+void System::field(Node *node)
 {
-    int filenum = stoi(node->right->text);
-    map<int, FileAccess *>::iterator it = m_openFiles.find(filenum);
-    if (it == m_openFiles.end())
+    int number = stoi(node->right->text);
+    FileAccess *f = file(number);
+    if (!f) return;
+    if (f->accessMode != am_random)
     {
-        m_errors.push_back("File number " + to_string(filenum) + " undefined");
+        m_errors.push_back("FIELD needs a file opened for RANDOM access");
         return;
-    } else if (it->second->accessMode != am_input)
+    }
+
+    vector<int> widths;
+    vector<string> fields;
+    for (Node *currNode = node->left; currNode; currNode = currNode->right)
+    {
+        widths.push_back(stoi(currNode->text));
+        fields.push_back(currNode->left->text);
+    }
+
+    if (!f->records->setLayout(widths))
     {
-        m_errors.push_back("Cannot read from a file that was opened for OUTPUT access");
+        m_errors.push_back("FIELD is longer than the record length of file #" + to_string(number));
         return;
     }
+    f->fields = fields;
+}
 
-    ifstream *input = dynamic_cast<ifstream *>(it->second->stream);
-    char c;
-    string s = "";
-    while ((c = input->get()))
+// The RANDOM file a GET or PUT uses, and the record number: the one given,
+// or the one after the last record read or written
+FileAccess *System::recordAccess(Node *node, int &record)
+{
+    int number = stoi(node->right->text);
+    FileAccess *f = file(number);
+    if (!f) return nullptr;
+    if (f->accessMode != am_random)
+    {
+        m_errors.push_back(string(node->type == nt_get ? "GET" : "PUT") + " needs a file opened for RANDOM access");
+        return nullptr;
+    }
+
+    record = f->records->position() + 1;
+    if (node->left)
     {
-        if (c == ',' || c == ':' || c == ';' || c == '\n') 
+        Value v = expression(node->left);
+        if (!v.isInteger() || v.integer() < 1)
         {
-            break;
-        } else if (c != '\r') s += c;
+            m_errors.push_back("Bad record number: \"" + v.string() + "\"");
+            return nullptr;
+        }
+        record = v.integer();
+    }
+
+    return f;
+}
+
+void System::get(Node *node)
+{
+    TraceSpan span("GET#", stoi(node->right->text));
+    int record;
+    FileAccess *f = recordAccess(node, record);
+    if (!f) return;
+
+    if (!f->records->get(record))
+    {
+        m_errors.push_back("Error reading from file #" + to_string(f->number));
+        return;
+    }
+
+    for (size_t i = 0; i < f->fields.size(); i++)
+    {
+        string s = f->records->field(i);
+        Value v;
+        if (f->fields[i].back() == '$') v = Value(s);
+        else if (s.empty()) v = Value(0);
+        else
+        {
+            v = FieldReader::number(s);
+            if (v.isNull())
+            {
+                m_errors.push_back("Type mismatch");
+                return;
+            }
+        }
+        setVariable(f->fields[i], v);
+    }
+}
+
+void System::put(Node *node)
+{
+    TraceSpan span("PUT#", stoi(node->right->text));
+    int record;
+    FileAccess *f = recordAccess(node, record);
+    if (!f) return;
+
+    // Text too long for its field is cut, but a number cut short would
+    // read back as a different number
+    for (size_t i = 0; i < f->fields.size(); i++)
+    {
+        string s = getVariable(f->fields[i]).string();
+        if (f->fields[i].back() != '$' && int(s.size()) > f->records->fieldWidth(i))
+        {
+            m_errors.push_back("Field overflow");
+            return;
+        }
+        f->records->setField(i, s);
+    }
+
+    if (!f->records->put(record)) m_errors.push_back("Error writing to file #" + to_string(f->number));
+}
+
+void System::inputfile(Node *node) 
+{
+    int filenum = stoi(node->right->text);
+    TraceSpan span("INPUT#", filenum);
+    FileAccess *f = file(filenum);
+    if (!f) return;
+    if (f->accessMode != am_input)
+    {
+        m_errors.push_back("Cannot read from a file that was opened for " + accessName(f->accessMode) + " access");
+        return;
+    }
+
+    string s;
+    if (!f->reader->next(s))
+    {
+        m_errors.push_back("Input past end of file");
+        return;
     }
 
     string var = node->left->text;
     Value result;
     if (var.back() == '$') result = Value(s);
-    else if (is_number(s)) result = Value(stoi(s));
-    else 
+    else
     {
-        m_errors.push_back("Type mismatch");
-        return;
+        result = FieldReader::number(s);
+        if (result.isNull())
+        {
+            m_errors.push_back("Type mismatch");
+            return;
+        }
     }
     setVariable(node->left, result);
 }
 
+// Reads the rest of a file into array(1), array(2) ...
+void System::matInput(Node *node)
+{
+    int filenum = stoi(node->right->text);
+    TraceSpan span("MAT INPUT#", filenum);
+    FileAccess *f = file(filenum);
+    if (!f) return;
+    if (f->accessMode != am_input)
+    {
+        m_errors.push_back("Cannot read from a file that was opened for " + accessName(f->accessMode) + " access");
+        return;
+    }
+
+    string name = node->left->text;
+    vector<Value> values;
+    string bad;
+    if (!FieldReader::parseAll(f->reader->rest(), name.back() == '$', values, bad))
+    {
+        m_errors.push_back("Type mismatch: \"" + bad + "\"");
+        return;
+    }
+
+    transform(name.begin(), name.end(), name.begin(), [](unsigned char c){ return tolower(c); });
+    name += "__";
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        storeVariable(name + to_string(i + 1), move(values[i]));
+    }
+    m_counters.variableWrites += values.size();
+    f->matCount = values.size();
+}
+
 void System::input(Node *node) 
 {
     string var = node->left->text;
     string prompt = (node->right ? node->right->text : "");
     Value result;
-    if (var.back() == '$') result = Value(m_output->inputString(prompt));
-    else result = Value(m_output->inputNumber(prompt));
+    flushTimedFiles(true);
+    {
+        TraceSpan span("INPUT");
+        if (var.back() == '$') result = Value(m_output->inputString(prompt));
+        else result = Value(m_output->inputNumber(prompt));
+    }
     setVariable(node->left, result);
 }
 
@@ -428,6 +832,7 @@ void System::goto_(Node *node)
     if (v.type() == vt_integer)
     {
         nextLineNo = v.integer();
+        m_counters.branches++;
     } else 
     {
         m_errors.push_back("Invalid value for GOTO: \"" + v.string() + "\"");
@@ -436,6 +841,8 @@ void System::goto_(Node *node)
 
 void System::branchTo(int lineNum, Node *node)
 {
+    m_counters.branches++;
+    stepTowardsFlush();
     this->currLine = lineNum;
     this->currNode = node;
     map<int, ProgramLine *>::iterator it = m_program.find(lineNum);
@@ -461,6 +868,8 @@ void System::return_(Node *node)
     {
         LineLocation l = m_gosub.top();
         m_gosub.pop();
+        m_profiler.ret();
+        tracer.end();
         branchTo(l.lineNum, l.node);
     }
 }
@@ -535,7 +944,10 @@ void System::gosub(Node *node)
     if (v.type() == vt_integer)
     {
         m_gosub.push(LineLocation(currLine, node->right));
+        m_profiler.call(v.integer());
+        tracer.begin("GOSUB", v.integer());
         nextLineNo = v.integer();
+        m_counters.branches++;
     } else 
     {
         m_errors.push_back("Invalid value for GOSUB: \"" + v.string() + "\"");
@@ -545,14 +957,12 @@ void System::gosub(Node *node)
 void System::printfile(Node *node) 
 {
     int filenum = stoi(node->right->text);
-    map<int, FileAccess *>::iterator it = m_openFiles.find(filenum);
-    if (it == m_openFiles.end())
-    {
-        m_errors.push_back("File number " + to_string(filenum) + " undefined");
-        return;
-    } else if (it->second->accessMode != am_output)
+    TraceSpan span("PRINT#", filenum);
+    FileAccess *f = file(filenum);
+    if (!f) return;
+    if (f->accessMode != am_output)
     {
-        m_errors.push_back("Cannot write to a file that was opened for INPUT access");
+        m_errors.push_back("Cannot write to a file that was opened for " + accessName(f->accessMode) + " access");
         return;
     }
 
@@ -566,63 +976,8 @@ void System::printfile(Node *node)
         currNode = currNode->right;
     }
 
-    *(dynamic_cast<ofstream *>(it->second->stream)) << s;
-    if (!append) *(dynamic_cast<ofstream *>(it->second->stream)) << endl;
-}
-
-string System::formatString(string s, string format)
-{
-    class comma_numpunct : public std::numpunct<char>
-    {
-        public:
-            comma_numpunct(bool grouping)
-            {
-                this->m_grouping = grouping;
-            }
-
-        protected:
-            bool m_grouping = false;
-
-            virtual char do_thousands_sep() const
-            {
-                return ',';
-            }
-
-            virtual std::string do_grouping() const
-            {
-                return (m_grouping ? "\03" : "");
-            }
-    };
-
-    if (format == "") return s;
-    if (!isInteger(s) && !isFloat(s)) return s;
-
-    float num = stof(s, NULL);
-
-    int dotLoc = format.find('.');
-    int commaLoc = format.find(",");
-    bool dollarSign = format.at(0) == '$';
-
-    string fa = (dotLoc > -1 ? format.substr(0, dotLoc) : format);
-    string fb = (dotLoc > -1 ? format.substr(dotLoc + 1, INT_MAX) : "");
-    
-    size_t firstSize = std::count(fa.begin(), fa.end(), '#');
-    size_t lastSize = std::count(fb.begin(), fb.end(), '#');
-
-    stringstream ss;
-    locale comma_locale(locale(), new comma_numpunct((commaLoc < dotLoc) || (commaLoc > -1 && dotLoc == -1)));
-
-    // tell cout to use our new locale.
-    ss.imbue(comma_locale);
-
-    ss << setprecision(lastSize) << fixed << num;
-
-    string result = ss.str();
-    if (dollarSign) result = "$" + result;
-    dotLoc = result.find('.');
-    if (dotLoc > -1 && firstSize > static_cast<size_t>(dotLoc)) result = string(firstSize - dotLoc, ' ') + result;
-
-    return result;
+    if (!append) s += '\n';
+    if (!f->writer->write(s)) writeFailed(f);
 }
 
 void System::print(Node *node) 
@@ -685,9 +1040,15 @@ bool System::isComparisonNode(NodeType type)
             type == nt_greaterequal || type == nt_less || type == nt_lessequal);
 }
 
+bool isNumericType(ValueType type)
+{
+    return (type == vt_integer || type == vt_real);
+}
+
 Value System::boolExpression(Node *node)
 {
     if (!node) throw "Missing parameter";
+    m_counters.expressions++;
     if (node->type == nt_string)
         throw "Type mismatch: Expecting boolean, found \"" + node->text + "\"";
 
@@ -707,6 +1068,17 @@ Value System::boolExpression(Node *node)
     {
         Value v1 = boolExpression(node->left);
         return Value(!v1.boolean());
+    } else if (node->left && node->right &&
+               isNumericType(node->left->valueType) && isNumericType(node->right->valueType))
+    {
+        float v1 = realKernel(node->left);
+        float v2 = realKernel(node->right);
+        if (node->type == nt_equal) return Value(v1 == v2);
+        if (node->type == nt_notequal) return Value(v1 != v2);
+        if (node->type == nt_greater) return Value(v1 > v2);
+        if (node->type == nt_less) return Value(v1 < v2);
+        if (node->type == nt_greaterequal) return Value(v1 >= v2);
+        if (node->type == nt_lessequal) return Value(v1 <= v2);
     } else if (node->type == nt_equal) return add(node->left).equals(add(node->right));
     else if (node->type == nt_greater) return add(node->left).isGreaterThan(add(node->right));
     else if (node->type == nt_less) return add(node->left).isLessThan(add(node->right));
@@ -731,67 +1103,99 @@ bool isNumeric(NodeType type)
     return (type == nt_integer || nt_real);
 }
 
-Value System::add(Node *node)
+bool isArithmeticNode(NodeType type)
 {
-    if (node->type == nt_integer) return Value(stoi(node->text));
-    if (node->type == nt_real) return Value(stof(node->text));
-    if (node->type == nt_string) return Value(node->text);
-    if (node->type == nt_identifier) return getVariable(node);
-    if (node->type == nt_function) return function(node);
+    return (type == nt_add || type == nt_minus || type == nt_mult || type == nt_div ||
+            type == nt_negate || type == nt_power);
+}
 
-    if (node->type == nt_add)
+// Operator nodes are counted here and their operands where they're evaluated
+int System::integerKernel(Node *node)
+{
+    if (node->type == nt_add || node->type == nt_minus || node->type == nt_mult || node->type == nt_negate)
     {
-        Value v1 = add(node->left);
-        Value v2 = add(node->right);
+        m_counters.expressions++;
+    }
 
-        if (v1.type() == vt_integer && v2.type() == vt_integer) return Value(v1.integer() + v2.integer());    
-        if (v1.type() == vt_integer && v2.type() == vt_real) return Value(v1.integer() + v2.real());    
-        if (v1.type() == vt_real && v2.type() == vt_real) return Value(v1.real() + v2.real());    
-        if (v1.type() == vt_real && v2.type() == vt_integer) return Value(v1.real() + v2.integer());    
-        if (v1.type() == vt_string && v2.type() == vt_string) return Value(v1.string() + v2.string());   
-    } else if (node->type == nt_minus)
-    {
-        Value v1 = add(node->left);
-        Value v2 = add(node->right);
+    switch (node->type)
+    {
+        case nt_add:
+            return integerKernel(node->left) + integerKernel(node->right);
+        case nt_minus:
+            return integerKernel(node->left) - integerKernel(node->right);
+        case nt_mult:
+            return integerKernel(node->left) * integerKernel(node->right);
+        case nt_negate:
+            return integerKernel(node->left) * -1;
+        default:
+            return add(node).integer();
+    }
+}
 
-        if (v1.type() == vt_integer && v2.type() == vt_integer) return Value(v1.integer() - v2.integer());    
-        if (v1.type() == vt_integer && v2.type() == vt_real) return Value(v1.integer() - v2.real());    
-        if (v1.type() == vt_real && v2.type() == vt_real) return Value(v1.real() - v2.real());    
-        if (v1.type() == vt_real && v2.type() == vt_integer) return Value(v1.real() - v2.integer());    
-    } else if (node->type == nt_mult)
-    {
-        Value v1 = add(node->left);
-        Value v2 = add(node->right);
+float System::realKernel(Node *node)
+{
+    // Keep integer subtrees exact, just as the generic path does
+    if (node->valueType == vt_integer) return float(integerKernel(node));
+
+    if (isArithmeticNode(node->type)) m_counters.expressions++;
+
+    switch (node->type)
+    {
+        case nt_add:
+            return realKernel(node->left) + realKernel(node->right);
+        case nt_minus:
+            return realKernel(node->left) - realKernel(node->right);
+        case nt_mult:
+            return realKernel(node->left) * realKernel(node->right);
+        case nt_div:
+            return realKernel(node->left) / realKernel(node->right);
+        case nt_negate:
+            return realKernel(node->left) * -1.0;
+        case nt_power:
+            return pow(double(realKernel(node->left)), double(realKernel(node->right)));
+        default:
+            return add(node).real();
+    }
+}
 
-        if (v1.type() == vt_integer && v2.type() == vt_integer) return Value(v1.integer() * v2.integer());    
-        if (v1.type() == vt_integer && v2.type() == vt_real) return Value(v1.integer() * v2.real());    
-        if (v1.type() == vt_real && v2.type() == vt_real) return Value(v1.real() * v2.real());    
-        if (v1.type() == vt_real && v2.type() == vt_integer) return Value(v1.real() * v2.integer());    
-    } else if (node->type == nt_div)
+Value System::add(Node *node)
+{
+    if (node->compiled)
     {
-        Value v1 = add(node->left);
-        Value v2 = add(node->right);
+        m_counters.expressions++;
+        return node->compiled->value();
+    }
 
-        if (v1.type() == vt_integer && v2.type() == vt_integer) return Value(float(v1.integer()) / float(v2.integer()));    
-        if (v1.type() == vt_integer && v2.type() == vt_real) return Value(float(v1.integer()) / v2.real());    
-        if (v1.type() == vt_real && v2.type() == vt_real) return Value(v1.real() / v2.real());    
-        if (v1.type() == vt_real && v2.type() == vt_integer) return Value(v1.real() / float(v2.integer()));    
-    } else if (node->type == nt_negate)
-    {
-        Value v1 = add(node->left);
+    // Nodes typed by TypeInference skip the per-operation tag checks below;
+    // the kernels count the nodes they evaluate
+    if (node->valueType == vt_integer && isArithmeticNode(node->type)) return Value(integerKernel(node));
+    if (node->valueType == vt_real && isArithmeticNode(node->type)) return Value(realKernel(node));
+
+    m_counters.expressions++;
+
+    if (node->type == nt_integer) return Value(stoi(node->text));
+    if (node->type == nt_real) return Value(stof(node->text));
+    if (node->type == nt_string) return Value(node->text);
+    if (node->type == nt_identifier) return getVariable(node);
+    if (node->type == nt_function) return function(node);
 
-        if (v1.type() == vt_integer) return Value(v1.integer() * -1);    
-        if (v1.type() == vt_real) return Value(float(v1.real() * -1.0));    
-    } else if (node->type == nt_power)
+    Value result;
+    if (node->type == nt_negate)
+    {
+        result = add(node->left).negate();
+    } else if (isArithmeticNode(node->type))
     {
         Value v1 = add(node->left);
         Value v2 = add(node->right);
 
-        if (v1.type() == vt_integer && v2.type() == vt_integer) return Value(pow(v1.integer(), v2.integer()));    
-        if (v1.type() == vt_integer && v2.type() == vt_real) return Value(pow(v1.integer(), v2.real()));    
-        if (v1.type() == vt_real && v2.type() == vt_real) return Value(pow(v1.real(), v2.real()));    
-        if (v1.type() == vt_real && v2.type() == vt_integer) return Value(pow(v1.real(), v2.integer()));    
+        if (node->type == nt_add) result = v1.add(v2);
+        else if (node->type == nt_minus) result = v1.subtract(v2);
+        else if (node->type == nt_mult) result = v1.multiply(v2);
+        else if (node->type == nt_div) result = v1.divide(v2);
+        else result = v1.power(v2);
     }
+    if (!result.isNull()) return result;
+
     m_errors.push_back("Type mismatch");
     return Value();
 }
@@ -801,6 +1205,7 @@ Value System::getVariable(string id)
     transform(id.begin(), id.end(), id.begin(),
     [](unsigned char c){ return tolower(c); });
 
+    m_counters.variableReads++;
     if (m_variables.find(id) == m_variables.end())
     {
         return Value(0);
@@ -839,25 +1244,59 @@ void System::setVariable(Node *node, Value v)
     setVariable(id, v);
 }
 
+Value *System::findVariable(VariableSlot &slot)
+{
+    m_counters.variableReads++;
+
+    // CLEAR bumps the generation, dropping every cached binding
+    if (slot.generation != m_variablesGeneration)
+    {
+        map<string, Value>::iterator it = m_variables.find(slot.id);
+        if (it == m_variables.end()) return nullptr;
+
+        slot.value = &it->second;
+        slot.generation = m_variablesGeneration;
+    }
+
+    return slot.value;
+}
+
 void System::setVariable(string id, Value v)
 {
-    cout << "Setting " << id << " to " << v.string() << endl;
     transform(id.begin(), id.end(), id.begin(),
     [](unsigned char c){ return tolower(c); });
 
-    m_variables[id] = v;
+    m_counters.variableWrites++;
+    storeVariable(id, move(v));
+}
+
+// Every write to m_variables comes through here, so MEM's counts are kept
+// as it happens; id is already lower case
+void System::storeVariable(const string &id, Value v)
+{
+    pair<map<string, Value>::iterator, bool> entry = m_variables.try_emplace(id);
+    Value &slot = entry.first->second;
+    if (entry.second)
+    {
+        bool element = (id.find("__") != string::npos);
+        m_memory.add(element ? mc_arrays : mc_variables, variableBytes(id));
+    }
+
+    size_t before = slot.heapBytes();
+    slot = move(v);
+    size_t after = slot.heapBytes();
+    if (after > before) m_memory.add(mc_strings, after - before);
+    else if (after < before) m_memory.remove(mc_strings, before - after);
 }
 
 Value System::expression(Node *node)
 {
     if (!node) return Value();
 
-    if (node->type == nt_string) return Value(node->text);
-    else if (node->type == nt_integer) return Value(stoi(node->text));
-    else if (node->type == nt_real) return Value(stof(node->text));
-    else if (node->type == nt_function) return function(node);
-    else if (isBoolNode(node->type)) return boolExpression(node);
-    else return add(node);
+    // add() evaluates (and counts) literals, functions and compiled
+    // expressions just as this used to
+    if (!node->compiled && isBoolNode(node->type)) return boolExpression(node);
+    return add(node);
 }
 
 Value System::tab(const Value &v)
@@ -912,6 +1351,58 @@ Value System::valFunc(const Value &v)
     else return Value(0);
 }
 
+// The open file a function like EOF() is given, which must have the access mode it needs
+FileAccess *System::fileArgument(const Value &v, const string &function, AccessMode accessMode)
+{
+    if (!v.isInteger())
+    {
+        m_errors.push_back("Type mismatch in call to " + function + "()");
+        return nullptr;
+    }
+
+    FileAccess *f = file(v.integer());
+    if (!f) return nullptr;
+    if (f->accessMode != accessMode)
+    {
+        m_errors.push_back(function + "() needs a file opened for " + accessName(accessMode) + " access");
+        return nullptr;
+    }
+
+    return f;
+}
+
+Value System::eofFunc(const Value &v)
+{
+    FileAccess *f = fileArgument(v, "EOF", am_input);
+    if (!f) return Value();
+
+    return Value(f->reader->eof());
+}
+
+Value System::lofFunc(const Value &v)
+{
+    FileAccess *f = fileArgument(v, "LOF", am_random);
+    if (!f) return Value();
+
+    return Value(int(f->records->length()));
+}
+
+Value System::locFunc(const Value &v)
+{
+    FileAccess *f = fileArgument(v, "LOC", am_random);
+    if (!f) return Value();
+
+    return Value(f->records->position());
+}
+
+Value System::numFunc(const Value &v)
+{
+    FileAccess *f = fileArgument(v, "NUM", am_input);
+    if (!f) return Value();
+
+    return Value(f->matCount);
+}
+
 Value System::rnd(const Value &v)
 {
     if (!v.isInteger())
@@ -944,6 +1435,10 @@ Value System::function(Node *node)
     if (ltext == "str$") return strFunc(param);
     if (ltext == "val") return valFunc(param);
     if (ltext == "chr$") return chrFunc(param);
+    if (ltext == "eof") return eofFunc(param);
+    if (ltext == "lof") return lofFunc(param);
+    if (ltext == "loc") return locFunc(param);
+    if (ltext == "num") return numFunc(param);
     else return Value();
 }
 
@@ -983,6 +1478,78 @@ void System::trun(Node *node)
     m_output->addText("Execution duration: " + to_string(duration));
 }
 
+// The ON or OFF after JIT, PROFILE or TRACE, if there is one; false after
+// reporting anything else
+bool System::setSwitch(Node *mode, bool &setting)
+{
+    if (!mode) return true;
+
+    string s = mode->text;
+    transform(s.begin(), s.end(), s.begin(), [](unsigned char c){ return tolower(c); });
+
+    if (s == "on") setting = true;
+    else if (s == "off") setting = false;
+    else 
+    {
+        m_errors.push_back("Expected ON or OFF; found \"" + mode->text + "\"");
+        return false;
+    }
+
+    return true;
+}
+
+void System::jit(Node *node)
+{
+    if (!setSwitch(node->right, m_jitEnabled)) return;
+
+    m_output->addText("JIT is " + string(m_jitEnabled ? "ON" : "OFF") + 
+        ", " + to_string(m_lineCompiler.compiledLines()) + " lines compiled in last run");
+}
+
+// PROFILE [ON | OFF | "file"]: ON samples every later RUN, and "file"
+// writes the last run's samples there as collapsed stacks
+void System::profile(Node *node)
+{
+    if (node->right && node->right->type == nt_string)
+    {
+        if (!m_profiler.write(node->right->text)) m_errors.push_back("Unable to write " + node->right->text);
+        return;
+    }
+
+    if (!setSwitch(node->right, m_profiling)) return;
+
+    m_output->addText("PROFILE is " + string(m_profiling ? "ON" : "OFF") + 
+        ", " + to_string(m_profiler.samples()) + " samples in last run");
+}
+
+void System::profileTo(const string &filename)
+{
+    m_profiling = true;
+    m_profileFile = filename;
+}
+
+// TRACE [ON | OFF | "file"]: ON records a timeline of every later RUN, and
+// "file" writes the last one there as Chrome trace_event JSON
+void System::trace(Node *node)
+{
+    if (node->right && node->right->type == nt_string)
+    {
+        if (!tracer.write(node->right->text)) m_errors.push_back("Unable to write " + node->right->text);
+        return;
+    }
+
+    if (!setSwitch(node->right, m_tracing)) return;
+
+    m_output->addText("TRACE is " + string(m_tracing ? "ON" : "OFF") + 
+        ", " + to_string(tracer.events()) + " events in last run");
+}
+
+void System::traceTo(const string &filename)
+{
+    m_tracing = true;
+    m_traceFile = filename;
+}
+
 void System::handleData(Node *node)
 {
     Node *currNode = node->left;
@@ -993,6 +1560,7 @@ void System::handleData(Node *node)
         if (currNode->type == nt_real) v = Value(stof(currNode->text));
         if (currNode->type == nt_string) v = Value(currNode->text);
         m_dataStack.push(v);
+        m_memory.add(mc_data, sizeof(Value) + v.heapBytes());
         currNode = currNode->right;
     }
 }
@@ -1001,6 +1569,7 @@ void System::processData()
 {
     queue<Value> empty;
     swap(m_dataStack, empty);
+    m_memory.set(mc_data, 0);
     
     for (map<int, ProgramLine *>::iterator it = m_program.begin(); it != m_program.end(); it++)
     {
@@ -1013,23 +1582,14 @@ void System::processData()
     }
 }
 
-void System::waitForClearKeyboard()
-{
-    string s = m_output->getKey();
-    while (s != "")
-    {
-        singleLoop();
-        s = m_output->getKey();
-    }
-}
-
 void System::preprocess(Node *node)
 {
     UNUSED(node)
 
-    waitForClearKeyboard();
-
     processData();    
+
+    m_typeInference.analyze(m_program, m_variables);
+    m_lineCompiler.reset(m_program);
 }
 
 void System::run(Node *node) 
@@ -1046,7 +1606,12 @@ void System::run(Node *node)
     m_forStack.clear();
     m_for.clear();
     m_errors.clear();
-    loopResult = l_runningProgram;  // clear out any prior ESC
+    m_counters = RunCounters();
+    counters.reset();
+    m_historyCount = 0;
+    if (m_profiling) m_profiler.start();
+    if (m_tracing) tracer.start();
+    setLoopResult(l_runningProgram);  // clear out any prior ESC
     Parser *p = new Parser();
     while (it != m_program.end())
     {
@@ -1068,8 +1633,12 @@ void System::run(Node *node)
             break;
         }
         currLine = it->second->lineNum;
+        m_profiler.line(currLine);
+        if (m_tron) m_output->addText("[" + to_string(currLine) + "]", pam_append);
         Node *stmts = line->left;
 
+        if (m_jitEnabled && ++it->second->executions == JIT_THRESHOLD) m_lineCompiler.compile(it->second);
+
         if (p->hasErrors())
         {
             vector<ParseError> errors = p->errors();
@@ -1086,6 +1655,8 @@ void System::run(Node *node)
         // execute statements
         if (loopResult == l_runningProgram) statements(stmts);
 
+        stepTowardsFlush();
+
         if (m_errors.size() > 0) break;
 
         if (nextLineNo == NO_LINE_NUM) it++;
@@ -1103,19 +1674,38 @@ void System::run(Node *node)
         if (m_output->loop() != l_runningProgram) 
         {
 //            if (loopResult == l_escape) m_output->addText("Break");
-            loopResult = l_running;
+            setLoopResult(l_running);
             break;
         }
     }
 
     free(p);
-    loopResult = l_running;
+    setLoopResult(l_running);
+
+    if (m_profiling)
+    {
+        m_profiler.stop();
+        if (m_profileFile != "" && !m_profiler.write(m_profileFile))
+        {
+            m_output->addText("Unable to write profile to " + m_profileFile);
+        }
+    }
+
+    if (m_tracing)
+    {
+        tracer.stop();
+        if (m_traceFile != "" && !tracer.write(m_traceFile))
+        {
+            m_output->addText("Unable to write trace to " + m_traceFile);
+        }
+    }
 }
 
 void System::bye(Node *node) 
 {
     UNUSED(node)
 
+    flushFiles();
     m_output->terminate();
 }
 
@@ -1126,9 +1716,26 @@ void System::scnclr(Node *node)
     m_output->clearText();
 }
 
+// STAT's names for the statements it counts, in the order it lists them
+static const vector<pair<NodeType, string>> statementNames = {
+    {nt_assign, "LET"}, {nt_print, "PRINT"}, {nt_if, "IF"}, {nt_else, "ELSE"},
+    {nt_for, "FOR"}, {nt_next, "NEXT"}, {nt_goto, "GOTO"}, {nt_gosub, "GOSUB"},
+    {nt_return, "RETURN"}, {nt_input, "INPUT"}, {nt_getkey, "GETKEY"},
+    {nt_data, "DATA"}, {nt_read, "READ"}, {nt_restore, "RESTORE"}, {nt_dim, "DIM"},
+    {nt_remark, "REM"}, {nt_scnclr, "SCNCLR"}, {nt_clear, "CLEAR"}, {nt_open, "OPEN"},
+    {nt_close, "CLOSE"}, {nt_printfile, "PRINT#"}, {nt_inputfile, "INPUT#"},
+    {nt_matinput, "MAT INPUT#"}, {nt_flush, "FLUSH"}, {nt_field, "FIELD"},
+    {nt_get, "GET#"}, {nt_put, "PUT#"}, {nt_tron, "TRON"}, {nt_troff, "TROFF"},
+    {nt_end, "END"}
+};
+
 void System::stat(Node *node) 
 {
-    UNUSED(node)
+    if (node->right)
+    {
+        writeStat(node->right->text);
+        return;
+    }
 
     m_output->addText("m_program. lines in memory: " + to_string(m_program.size()));
     if (m_variables.size() > 0)
@@ -1163,6 +1770,189 @@ void System::stat(Node *node)
     {
         m_output->addText("Variables: [None defined]");
     }
+
+    uint64_t total = 0;
+    for (uint64_t n : m_counters.statements) total += n;
+
+    m_output->addText("Counters for the last RUN:");
+    m_output->addText("  Statements: " + to_string(total));
+    for (const pair<NodeType, string> &s : statementNames)
+    {
+        uint64_t n = m_counters.statements[s.first];
+        if (n > 0) m_output->addText("    " + s.second + ": " + to_string(n));
+    }
+    m_output->addText("  Expression nodes: " + to_string(m_counters.expressions));
+    m_output->addText("  Variable reads: " + to_string(m_counters.variableReads));
+    m_output->addText("  Variable writes: " + to_string(m_counters.variableWrites));
+    m_output->addText("  Branches: " + to_string(m_counters.branches));
+    m_output->addText("  String values: " + to_string(counters.stringValues.load()));
+    m_output->addText("  File bytes read: " + to_string(counters.bytesRead.load()));
+    m_output->addText("  File bytes written: " + to_string(counters.bytesWritten.load()));
+    m_output->addText("  Frames drawn: " + to_string(counters.frames.load()));
+}
+
+// STAT "file": the same counters as JSON, for tools rather than people
+void System::writeStat(const string &filename)
+{
+    ofstream out(filename);
+    if (!out)
+    {
+        m_errors.push_back("Unable to write " + filename);
+        return;
+    }
+
+    uint64_t total = 0;
+    for (uint64_t n : m_counters.statements) total += n;
+
+    out << "{\n";
+    out << "  \"lines\": " << m_program.size() << ",\n";
+    out << "  \"variables\": " << m_variables.size() << ",\n";
+    out << "  \"statements\": {\n";
+    out << "    \"total\": " << total;
+    for (const pair<NodeType, string> &s : statementNames)
+    {
+        out << ",\n    \"" << s.second << "\": " << m_counters.statements[s.first];
+    }
+    out << "\n  },\n";
+    out << "  \"expressionNodes\": " << m_counters.expressions << ",\n";
+    out << "  \"variableReads\": " << m_counters.variableReads << ",\n";
+    out << "  \"variableWrites\": " << m_counters.variableWrites << ",\n";
+    out << "  \"branches\": " << m_counters.branches << ",\n";
+    out << "  \"stringValues\": " << counters.stringValues << ",\n";
+    out << "  \"fileBytesRead\": " << counters.bytesRead << ",\n";
+    out << "  \"fileBytesWritten\": " << counters.bytesWritten << ",\n";
+    out << "  \"frames\": " << counters.frames << "\n";
+    out << "}\n";
+
+    if (!out.good()) m_errors.push_back("Unable to write " + filename);
+}
+
+// A variable or array element's map entry, less the heap part of its value
+size_t System::variableBytes(const string &id) const
+{
+    return MAP_NODE_BYTES + sizeof(pair<const string, Value>) + heapBytes(id);
+}
+
+size_t System::lineBytes(const ProgramLine *line) const
+{
+    return MAP_NODE_BYTES + sizeof(pair<const int, ProgramLine *>) + sizeof(ProgramLine) +
+        heapBytes(line->line) + nodeBytes(line->node);
+}
+
+size_t System::nodeBytes(const Node *node) const
+{
+    if (!node) return 0;
+
+    size_t result = sizeof(Node) + heapBytes(node->text) + heapBytes(node->data) + nodeBytes(node->left);
+
+    // A GOSUB node's right points back at its own statement
+    if (node->type != nt_gosub) result += nodeBytes(node->right);
+    return result;
+}
+
+// Buffers come and go with OPEN and CLOSE, and ASYNC writers add them as
+// they fall behind, so this is recounted rather than kept up to date
+void System::countFileMemory()
+{
+    size_t bytes = 0;
+    m_openFiles.forEach([&](FileAccess *f) { bytes += f->memoryUsed(); });
+    m_memory.set(mc_files, bytes);
+}
+
+// MEM: bytes held now and at most in each category, and the variables and
+// arrays holding the most
+void System::mem(Node *node)
+{
+    UNUSED(node)
+
+    const int TOP_VARIABLES = 10;
+
+    countFileMemory();
+
+    ostringstream ss;
+    ss << left << setw(12) << "" << right << setw(14) << "Bytes" << setw(14) << "High-water";
+    m_output->addText(ss.str());
+    for (int i = 0; i < mc_count; i++)
+    {
+        MemoryCategory category = MemoryCategory(i);
+        ss.str("");
+        ss << left << setw(12) << MemoryAccount::name(category) << right << setw(14) << m_memory.bytes(category)
+           << setw(14) << m_memory.peak(category);
+        m_output->addText(ss.str());
+    }
+    ss.str("");
+    ss << left << setw(12) << "Total" << right << setw(14) << m_memory.total() << setw(14) << m_memory.totalPeak();
+    m_output->addText(ss.str());
+
+    // Array elements are stored as name__index; gather them under name()
+    map<string, pair<size_t, size_t>> usage;
+    for (map<string, Value>::iterator it = m_variables.begin(); it != m_variables.end(); it++)
+    {
+        size_t split = it->first.find("__");
+        string name = (split == string::npos ? it->first : it->first.substr(0, split) + "()");
+        pair<size_t, size_t> &u = usage[name];
+        u.first += variableBytes(it->first) + it->second.heapBytes();
+        u.second++;
+    }
+
+    vector<pair<size_t, string>> largest;
+    for (map<string, pair<size_t, size_t>>::iterator it = usage.begin(); it != usage.end(); it++)
+    {
+        largest.push_back(make_pair(it->second.first, it->first));
+    }
+    sort(largest.begin(), largest.end(), greater<pair<size_t, string>>());
+    if (largest.size() > size_t(TOP_VARIABLES)) largest.resize(TOP_VARIABLES);
+
+    if (largest.empty()) return;
+    m_output->addText("Largest variables:");
+    for (vector<pair<size_t, string>>::iterator it = largest.begin(); it != largest.end(); it++)
+    {
+        ss.str("");
+        ss << "  " << left << setw(10) << it->second << right << setw(14) << it->first;
+        size_t elements = usage[it->second].second;
+        if (it->second.back() == ')') ss << "  " << elements << " elements";
+        m_output->addText(ss.str());
+    }
+}
+
+// HISTORY [n]: the last n statements run, or all that are kept
+void System::history(Node *node)
+{
+    if (m_historyCount == 0)
+    {
+        m_output->addText("No statements run");
+        return;
+    }
+
+    showHistory(node->right ? stoi(node->right->text) : HISTORY_SIZE);
+}
+
+// Lists the last count statements in the history, oldest first, as
+// line:statement with the statements of a line counted from 1
+void System::showHistory(uint64_t count)
+{
+    uint64_t kept = (m_historyCount < HISTORY_SIZE ? m_historyCount : HISTORY_SIZE);
+    if (count > kept) count = kept;
+    if (count == 0) return;
+
+    m_output->addText("Last " + to_string(count) + " of " + to_string(m_historyCount) + 
+        " statements run, as line:statement");
+
+    string row = "";
+    for (uint64_t i = m_historyCount - count; i < m_historyCount; i++)
+    {
+        uint64_t entry = m_history[i % HISTORY_SIZE];
+        int lineNum = int(uint32_t(entry >> 32));
+        string s = (lineNum == NO_LINE_NUM ? "direct" : to_string(lineNum)) + ":" + to_string(uint32_t(entry) + 1);
+
+        if (row != "" && int(row.size() + 1 + s.size()) > m_output->lineSize())
+        {
+            m_output->addText(row);
+            row = "";
+        }
+        row += (row == "" ? "" : " ") + s;
+    }
+    m_output->addText(row);
 }
 
 void System::new_(Node *node)
@@ -1170,12 +1960,14 @@ void System::new_(Node *node)
     UNUSED(node)
 
     m_program.clear();
+    m_memory.set(mc_program, 0);
     m_output->addText("Ok");
 }
 
 void System::load(Node *node)
 {
     m_program.clear();
+    m_memory.set(mc_program, 0);
     Node *filename = node->right;
 
     m_output->addText("Loading \"" + filename->text + "\"");
@@ -2,8 +2,15 @@
 #define _SYSTEM_HPP_
 
 #include "Console.hpp"
+#include "Counters.hpp"
+#include "FileTable.hpp"
 #include "Lexer.hpp"
+#include "LineCompiler.hpp"
+#include "Memory.hpp"
 #include "Parser.hpp"
+#include "Profiler.hpp"
+#include "Tracer.hpp"
+#include "TypeInference.hpp"
 #include "Value.hpp"
 
 #include <map>
@@ -14,6 +21,13 @@
 #include <iostream>
 #include <fstream>
 
+// Statements are dispatched with computed goto (labels as values) where the
+// compiler supports it; building with KBASIC_SWITCH_DISPATCH selects the
+// portable switch instead
+#if !defined(KBASIC_SWITCH_DISPATCH) && (defined(__GNUC__) || defined(__clang__))
+#define KBASIC_THREADED_DISPATCH
+#endif
+
 struct LineLocation {
     int lineNum;
     Node *node;
@@ -42,10 +56,21 @@ struct ForLocation {
     }
 };
 
+// The interpreter's always-on counters for STAT, which RUN starts again;
+// the ones bumped outside System are in Counters.hpp
+struct RunCounters {
+    uint64_t statements[nt_count] = {};     // By statement node type
+    uint64_t expressions = 0;               // Nodes evaluated; a compiled expression counts once
+    uint64_t variableReads = 0;
+    uint64_t variableWrites = 0;
+    uint64_t branches = 0;                  // IF decisions, GOTO, GOSUB, RETURN, NEXT looping back
+};
+
 struct ProgramLine {
     int lineNum;
     string line;
     Node *node;
+    int executions = 0;
 
     ProgramLine() {}
 
@@ -54,6 +79,7 @@ struct ProgramLine {
         lineNum = p2.lineNum;
         line = p2.line;
         node = p2.node;
+        executions = p2.executions;
     }
 
     ~ProgramLine()
@@ -62,55 +88,31 @@ struct ProgramLine {
     }
 };
 
-enum AccessMode { am_input, am_output };
-
-struct FileAccess {
-    int number;
-    ios *stream = nullptr;
-    AccessMode accessMode;
-    string filename;
-    bool m_open = false;
-
-    inline bool isOpen() const { return m_open; }
-
-    FileAccess(string name, int number, AccessMode accessMode)
-    {
-        this->filename = name;
-        this->number = number;
-        this->accessMode = accessMode;
-        if (accessMode == am_input) 
-        {
-            this->stream = new ifstream(name);
-            m_open = dynamic_cast<ifstream *>(stream)->is_open();
-        }
-        if (accessMode == am_output) 
-        {
-            this->stream = new ofstream(name);
-            m_open = dynamic_cast<ofstream *>(stream)->is_open();
-        }
-    }
-
-    ~FileAccess()
-    {
-        if (stream && accessMode == am_input) dynamic_cast<ifstream *>(stream)->close();
-        if (stream && accessMode == am_output) dynamic_cast<ofstream *>(stream)->close();
-    }
-};
-
 class System {
+    friend class LineCompiler;
+
 public:
     System();
     ~System();
 
     void command(string line, Console *output);
 
+    // Profile or trace every RUN and write the samples or the trace to
+    // filename when it ends
+    void profileTo(const string &filename);
+    void traceTo(const string &filename);
+
 private:
     const int NO_LINE_NUM = INT_MIN;
+    const int JIT_THRESHOLD = 100;
+    const int FLUSH_CHECK_STEPS = 64;       // Lines run and branches taken between checks for timed flushes
+    const int GETKEY_TIMEOUT = 50 * 1000 / FRAME_RATE;    // Milliseconds; 50 frames, as it always was
     map<int, ProgramLine *> m_program;
 
     map<string, Value> m_variables;
+    int m_variablesGeneration = 0;
 
-    map<int, FileAccess *> m_openFiles;
+    FileTable m_openFiles;
 
     stack<LineLocation> m_gosub;
     map<string, ForLocation> m_for;
@@ -120,6 +122,31 @@ private:
 
     vector<string> m_errors;
 
+    TypeInference m_typeInference;
+    LineCompiler m_lineCompiler;
+    bool m_jitEnabled = true;
+
+    RunCounters m_counters;
+    MemoryAccount m_memory;
+
+    Profiler m_profiler;
+    bool m_profiling = false;
+    string m_profileFile = "";
+    bool m_tracing = false;
+    string m_traceFile = "";
+
+    // The last HISTORY_SIZE statements run, oldest overwritten first, each
+    // packed as line << 32 | position so recording one is a single store
+    static const unsigned HISTORY_SIZE = 256;
+    static const unsigned ERROR_HISTORY = 8;      // Shown after a runtime error
+    uint64_t m_history[HISTORY_SIZE];
+    uint64_t m_historyCount = 0;
+    bool m_tron = false;
+
+    // Milliseconds between timed flushes of PRINT# output; FLUSH EVERY sets it
+    int m_flushInterval = 1000;
+    int m_flushCheck = 0;
+
     Console *m_output;
 
     enum IfState { ifs_none, ifs_yes, ifs_no };
@@ -140,7 +167,6 @@ private:
     bool isBoolNode(NodeType type);
     bool isComparisonNode(NodeType type);
 
-    void waitForClearKeyboard();
 
     int getLineNo(string line);
 
@@ -150,15 +176,23 @@ private:
     Value getVariable(string id);
     void setVariable(Node *node, Value v);
     void setVariable(string id, Value v);
+    void storeVariable(const string &id, Value v);
+    Value *findVariable(VariableSlot &slot);
 
     void processData();
 
-    string formatString(string s, string format);
-
     void execute(Node *node);
     void load(Node *node);
     void new_(Node *node);
     void stat(Node *node);
+    void mem(Node *node);
+    void history(Node *node);
+    void showHistory(uint64_t count);
+    size_t variableBytes(const string &id) const;
+    size_t lineBytes(const ProgramLine *line) const;
+    size_t nodeBytes(const Node *node) const;
+    void countFileMemory();
+    void writeStat(const string &filename);
     void bye(Node *node);
     void scnclr(Node *node);
     void list(Node *node);
@@ -166,16 +200,23 @@ private:
     void save(Node *node);
     void statements(Node *node);
     bool statement(Node *node);
+    bool dispatch(Node *node);
     void print(Node *node);
     void printfile(Node *node);
     void line(Node *node);
     void run(Node *node);
     void trun(Node *node);
+    bool setSwitch(Node *mode, bool &setting);
+    void jit(Node *node);
+    void profile(Node *node);
+    void trace(Node *node);
     void goto_(Node *node);
     void gosub(Node *node);
     void return_(Node *node);
     void assign(Node *node);
     Value add(Node *node);
+    int integerKernel(Node *node);
+    float realKernel(Node *node);
     void clear(Node *node);
     void if_(Node *node);
     void for_(Node *node);
@@ -183,14 +224,33 @@ private:
     void next(Node *node);
     void input(Node *node);
     void inputfile(Node *node);
+    void matInput(Node *node);
     void open(Node *node);
     void close(Node *node);
+    FileAccess *file(int number);
+    void flush(Node *node);
+    void flushFiles();
+    void flushTimedFiles(bool force);
+    void stepTowardsFlush();
+    void writeFailed(FileAccess *f);
+    void field(Node *node);
+    void get(Node *node);
+    void put(Node *node);
+    FileAccess *recordAccess(Node *node, int &record);
+    FileAccess *fileArgument(const Value &v, const string &function, AccessMode accessMode);
     void getkey(Node *node);
     void data(Node *node);
     void read(Node *node);
     void restore(Node *node);
 
     void branchTo(int lineNum, Node *node);
+
+    void remember(Node *statement)
+    {
+        m_history[m_historyCount++ % HISTORY_SIZE] =
+            (uint64_t(uint32_t(currLine)) << 32) | uint32_t(statement->position);
+    }
+
     void preprocess(Node *node);
     void handleData(Node *node);
 
@@ -205,6 +265,10 @@ private:
     Value rnd(const Value &v);
     Value valFunc(const Value &v);
     Value chrFunc(const Value &v);
+    Value eofFunc(const Value &v);
+    Value lofFunc(const Value &v);
+    Value locFunc(const Value &v);
+    Value numFunc(const Value &v);
 
     void lines();
     
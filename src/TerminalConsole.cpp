@@ -0,0 +1,158 @@
+#include "TerminalConsole.hpp"
+
+#include <iostream>
+#include <cstdlib>
+
+TerminalConsole::TerminalConsole(int lineSize, int lineCount)
+{
+    m_lineSize = lineSize;
+    m_lineCount = lineCount;
+    m_text = string(m_lineSize, ' ');
+}
+
+void TerminalConsole::addText(string s, PrintAppendMode appendMode)
+{
+    if (m_cursorPos + s.size() > m_text.size()) m_text.resize(m_cursorPos + s.size(), ' ');
+    m_text.replace(m_cursorPos, s.size(), s);
+    if (appendMode == pam_none)
+    {
+        newLine();
+    } else if (appendMode == pam_tab)
+    {
+        m_cursorPos = (int(m_cursorPos/10) + 1) * 10;
+        if (m_cursorPos > m_lineSize) newLine();
+    } else
+    {
+        m_cursorPos += s.size();
+    }
+}
+
+void TerminalConsole::newLine()
+{
+    string s = m_text;
+    rtrim(s);
+    show(s.size());
+    cout << '\n';
+
+    m_text = string(m_lineSize, ' ');
+    m_cursorPos = 0;
+    m_written = 0;
+    if (m_cursorLine < m_lineCount - 1) m_cursorLine++;
+}
+
+void TerminalConsole::show(int end)
+{
+    if (end > m_written)
+    {
+        cout << m_text.substr(m_written, end - m_written);
+        m_written = end;
+    }
+}
+
+void TerminalConsole::putTextAt(int location, string s, PrintAppendMode appendMode)
+{
+    if (location >= m_lineSize * m_lineCount) return;
+
+    string pending = m_text;
+    rtrim(pending);
+    show(pending.size());
+
+    m_cursorLine = location / m_lineSize;
+    m_cursorPos = location % m_lineSize;
+    cout << "\033[" << (m_cursorLine + 1) << ";" << (m_cursorPos + 1) << "H";
+    m_text = string(m_lineSize, ' ');
+    m_written = m_cursorPos;
+
+    addText(s, appendMode);
+}
+
+void TerminalConsole::clearText()
+{
+    cout << "\033[2J\033[H";
+    m_text = string(m_lineSize, ' ');
+    m_cursorPos = 0;
+    m_cursorLine = 0;
+    m_written = 0;
+}
+
+void TerminalConsole::terminate()
+{
+    string pending = m_text;
+    rtrim(pending);
+    show(pending.size());
+    cout.flush();
+}
+
+string TerminalConsole::readLine()
+{
+    show(m_cursorPos);
+    cout.flush();
+
+    string result;
+    if (!getline(cin, result))
+    {
+        // End of input stops the program, as ESC does in the window
+        addText("");
+        addText("Break");
+        terminate();
+        exit(0);
+    }
+    if (!result.empty() && result.back() == '\r') result.pop_back();
+
+    // The terminal has already echoed the newline
+    m_text = string(m_lineSize, ' ');
+    m_cursorPos = 0;
+    m_written = 0;
+    if (m_cursorLine < m_lineCount - 1) m_cursorLine++;
+
+    return result;
+}
+
+float TerminalConsole::inputNumber(string prompt)
+{
+    while (true)
+    {
+        addText(prompt + "? ", pam_append);
+        string s = readLine();
+        if (s == "") return 0.0;
+        if (isFloat(s)) return stof(s);
+        addText("Type mismatch");
+    }
+}
+
+string TerminalConsole::inputString(string prompt)
+{
+    addText(prompt + "? ", pam_append);
+    return readLine();
+}
+
+string TerminalConsole::getKey()
+{
+    // stdin is line buffered, so keys arrive once RETURN is pressed
+    show(m_cursorPos);
+    cout.flush();
+
+    int c = cin.get();
+    if (c == EOF)
+    {
+        addText("");
+        addText("Break");
+        terminate();
+        exit(0);
+    }
+
+    if (c == '\n') return "return";
+    return string(1, char(c));
+}
+
+CursorPos TerminalConsole::getCursorPos()
+{
+    return CursorPos(m_cursorPos, m_cursorLine);
+}
+
+void TerminalConsole::setCursorPos(const CursorPos &pos)
+{
+    if (pos.col > m_cursorPos && pos.col > int(m_text.size())) m_text.resize(pos.col, ' ');
+    m_cursorPos = pos.col;
+    m_cursorLine = pos.row;
+}
@@ -0,0 +1,46 @@
+#ifndef _TERMINALCONSOLE_HPP_
+#define _TERMINALCONSOLE_HPP_
+
+#include "Console.hpp"
+#include "main.hpp"
+
+/*
+ * Console on stdin/stdout for programs built by kbasic-aot.  The current
+ * line is kept in a buffer the same width as the window's, so PRINT's
+ * append/tab rules behave as they do in MainWindow; text reaches the
+ * terminal a line at a time, or when a prompt needs to be shown.
+ */
+class TerminalConsole : public Console {
+public:
+    TerminalConsole(int lineSize = SCREEN_WIDTH, int lineCount = SCREEN_HEIGHT);
+
+    void addText(string s, PrintAppendMode appendMode = pam_none);
+    void putTextAt(int location, string s, PrintAppendMode appendMode = pam_none);
+    void clearText();
+    void terminate();
+    bool loop() { return true; }
+    float inputNumber(string prompt);
+    string inputString(string prompt);
+    int lineSize() { return m_lineSize; }
+    int lineCount() { return m_lineCount; }
+    string getKey();
+    CursorPos getCursorPos();
+    void setCursorPos(const CursorPos &pos);
+
+private:
+    int m_lineSize;
+    int m_lineCount;
+
+    int m_cursorPos = 0;
+    int m_cursorLine = 0;
+
+    // Columns of m_text already written to the terminal
+    int m_written = 0;
+    string m_text;
+
+    void newLine();
+    void show(int end);
+    string readLine();
+};
+
+#endif
@@ -0,0 +1,101 @@
+#include "Tracer.hpp"
+
+#include <fstream>
+#include <iomanip>
+
+void Tracer::start()
+{
+    m_events.clear();
+    m_events.reserve(RESERVE);
+    m_open = 0;
+    {
+        lock_guard<mutex> lock(m_uiMutex);
+        m_uiEvents.clear();
+    }
+
+    m_start = chrono::steady_clock::now();
+    m_enabled.store(true, memory_order_relaxed);
+}
+
+void Tracer::stop()
+{
+    if (!enabled()) return;
+
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    {
+        lock_guard<mutex> lock(m_uiMutex);
+        m_enabled.store(false, memory_order_relaxed);
+    }
+
+    // GOSUBs left by GOTO, END or an error end with the run
+    for (; m_open > 0; m_open--) m_events.push_back({ "", -1, 'E', tt_interpreter, now, now });
+    m_events.push_back({ "RUN", -1, 'X', tt_interpreter, m_start, now });
+}
+
+void Tracer::begin(const char *name, int number)
+{
+    if (!enabled()) return;
+
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    m_events.push_back({ name, number, 'B', tt_interpreter, now, now });
+    m_open++;
+}
+
+void Tracer::end()
+{
+    // A RETURN for a GOSUB made before tracing started has nothing to end
+    if (!enabled() || m_open == 0) return;
+
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    m_events.push_back({ "", -1, 'E', tt_interpreter, now, now });
+    m_open--;
+}
+
+void Tracer::span(const char *name, int number, TraceThread thread,
+    chrono::steady_clock::time_point start, chrono::steady_clock::time_point end)
+{
+    if (thread == tt_interpreter)
+    {
+        if (enabled()) m_events.push_back({ name, number, 'X', thread, start, end });
+        return;
+    }
+
+    lock_guard<mutex> lock(m_uiMutex);
+    if (enabled()) m_uiEvents.push_back({ name, number, 'X', thread, start, end });
+}
+
+// Microseconds since the run started, which is what trace_event expects
+static double micros(chrono::steady_clock::duration d)
+{
+    return chrono::duration<double, micro>(d).count();
+}
+
+bool Tracer::write(const string &filename)
+{
+    ofstream out(filename);
+    if (!out) return false;
+
+    out << fixed << setprecision(3);
+    out << "{\"traceEvents\":[\n";
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tt_interpreter
+        << ",\"args\":{\"name\":\"interpreter\"}},\n";
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tt_ui
+        << ",\"args\":{\"name\":\"window\"}}";
+
+    lock_guard<mutex> lock(m_uiMutex);
+    for (const vector<TraceEvent> *events : { &m_events, &m_uiEvents })
+    {
+        for (const TraceEvent &e : *events)
+        {
+            out << ",\n{\"name\":\"" << e.name;
+            if (e.number >= 0) out << " " << e.number;
+            out << "\",\"ph\":\"" << e.phase << "\",\"pid\":1,\"tid\":" << e.thread
+                << ",\"ts\":" << micros(e.start - m_start);
+            if (e.phase == 'X') out << ",\"dur\":" << micros(e.end - e.start);
+            out << "}";
+        }
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+    return out.good();
+}
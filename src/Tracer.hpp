@@ -0,0 +1,87 @@
+#ifndef _TRACER_HPP_
+#define _TRACER_HPP_
+
+#include "main.hpp"
+
+#include <vector>
+#include <mutex>
+#include <chrono>
+
+// The timelines a trace has; the interpreter's is the only one that nests
+enum TraceThread { tt_interpreter = 1, tt_ui = 2 };
+
+struct TraceEvent {
+    const char *name;
+    int number;                 // Shown after the name unless negative: "GOSUB 1000", "PRINT# 2"
+    char phase;                 // 'X' a whole span, 'B' and 'E' its start and end
+    TraceThread thread;
+    chrono::steady_clock::time_point start;
+    chrono::steady_clock::time_point end;
+};
+
+/*
+ * Records a timeline of a RUN for chrome://tracing and Perfetto: the run
+ * itself, each GOSUB until its RETURN, file statements, waits for INPUT
+ * and GETKEY, and the window's frames.  Events are fixed-size records in
+ * memory, with names that are string literals, so recording one is a
+ * clock read and a store; they're only turned into trace_event JSON by
+ * write(), after the run.  The interpreter thread's events need no lock;
+ * the UI thread's frames go in their own list under a mutex.
+ */
+class Tracer {
+public:
+    // start() discards the last run's events
+    void start();
+    void stop();
+    bool enabled() const { return m_enabled.load(memory_order_relaxed); }
+
+    // Interpreter thread only: GOSUB opens a span and RETURN closes it
+    void begin(const char *name, int number);
+    void end();
+
+    void span(const char *name, int number, TraceThread thread,
+        chrono::steady_clock::time_point start, chrono::steady_clock::time_point end);
+
+    // Only once stopped
+    size_t events() const { return m_events.size() + m_uiEvents.size(); }
+    bool write(const string &filename);
+
+private:
+    static const size_t RESERVE = 1 << 16;
+
+    atomic<bool> m_enabled{false};
+    chrono::steady_clock::time_point m_start;
+    vector<TraceEvent> m_events;
+    int m_open = 0;                 // GOSUB spans not yet RETURNed from
+
+    mutex m_uiMutex;
+    vector<TraceEvent> m_uiEvents;
+};
+
+inline Tracer tracer;
+
+// Records the span from its construction to the end of the scope it's in
+class TraceSpan {
+public:
+    TraceSpan(const char *name, int number = -1, TraceThread thread = tt_interpreter)
+    {
+        if (!tracer.enabled()) return;
+        m_name = name;
+        m_number = number;
+        m_thread = thread;
+        m_start = chrono::steady_clock::now();
+    }
+
+    ~TraceSpan()
+    {
+        if (m_name) tracer.span(m_name, m_number, m_thread, m_start, chrono::steady_clock::now());
+    }
+
+private:
+    const char *m_name = nullptr;
+    int m_number;
+    TraceThread m_thread;
+    chrono::steady_clock::time_point m_start;
+};
+
+#endif
@@ -0,0 +1,877 @@
+#include "Translator.hpp"
+#include "System.hpp"
+
+#include <algorithm>
+#include <iomanip>
+
+Translator::~Translator()
+{
+    for (map<int, ProgramLine *>::iterator it = m_program.begin(); it != m_program.end(); it++)
+    {
+        delete it->second;
+    }
+}
+
+bool Translator::load(istream &in)
+{
+    string line;
+    while (getline(in, line))
+    {
+        istringstream iss(line);
+        string lineNo, rest;
+        if (!(iss >> lineNo) || !isInteger(lineNo)) continue;
+
+        int lineNum = stoi(lineNo);
+        if (!(iss >> rest))
+        {
+            m_program.erase(lineNum);
+            continue;
+        }
+
+        Parser parser;
+        Node *node = parser.parseStatements(line);
+        if (parser.hasErrors() || !node)
+        {
+            m_errors.push_back("Errors in line " + to_string(lineNum));
+            vector<ParseError> errors = parser.errors();
+            for (vector<ParseError>::iterator it = errors.begin(); it != errors.end(); it++)
+            {
+                m_errors.push_back(it->msg);
+            }
+            continue;
+        }
+
+        ProgramLine *p = new ProgramLine();
+        p->lineNum = lineNum;
+        p->line = line;
+        p->node = node;
+        if (m_program.find(lineNum) != m_program.end()) delete m_program[lineNum];
+        m_program[lineNum] = p;
+    }
+
+    return m_errors.empty();
+}
+
+void Translator::translate(ostream &out, const string &source)
+{
+    m_typeInference.analyze(m_program, map<string, Value>());
+    for (map<int, ProgramLine *>::iterator it = m_program.begin(); it != m_program.end(); it++)
+    {
+        scan(it->second->node);
+    }
+
+    m_firstPass = true;
+    generate();
+
+    if (m_usesDispatch)
+    {
+        for (map<int, ProgramLine *>::iterator it = m_program.begin(); it != m_program.end(); it++)
+        {
+            m_labels.insert(lineLabel(it->first));
+        }
+    }
+    if (m_usesResume)
+    {
+        for (int i = 0; i < m_points; i++) m_labels.insert("point_" + to_string(i));
+    }
+
+    m_firstPass = false;
+    generate();
+
+    out << "// Generated by kbasic-aot from " << source << "; do not edit" << endl;
+    out << endl;
+    out << "#include \"Runtime.hpp\"" << endl;
+    out << "#include \"TerminalConsole.hpp\"" << endl;
+    out << endl;
+    out << "#include <cmath>" << endl;
+    out << endl;
+    out << "enum IfState { ifs_none, ifs_yes, ifs_no };" << endl;
+    out << endl;
+    out << "int main()" << endl;
+    out << "{" << endl;
+    out << "    TerminalConsole console;" << endl;
+    out << "    Runtime rt(&console);" << endl;
+    out << "    IfState ifState = ifs_none;" << endl;
+    out << "    bool triggerElse = false;" << endl;
+    if (m_usesDispatch) out << "    int target = 0;" << endl;
+    if (m_usesResume) out << "    int point = 0;" << endl;
+    out << endl;
+
+    // A variable the program only ever sets is still declared, for the stores
+    for (set<string>::iterator it = m_scalars.begin(); it != m_scalars.end(); it++)
+    {
+        out << "    ";
+        if (m_readScalars.find(*it) == m_readScalars.end()) out << "[[maybe_unused]] ";
+        if (isIntegerScalar(*it)) out << "int " << scalarName(*it) << " = 0;" << endl;
+        else out << "Value " << scalarName(*it) << " = Value(0);" << endl;
+    }
+    if (!m_scalars.empty()) out << endl;
+
+    // DATA constants are collected up front, as System::processData does
+    bool hasData = false;
+    for (map<int, ProgramLine *>::iterator it = m_program.begin(); it != m_program.end(); it++)
+    {
+        for (Node *currNode = it->second->node->left; currNode; currNode = currNode->right)
+        {
+            if (!currNode->left || currNode->left->type != nt_data) continue;
+
+            for (Node *constant = currNode->left->left; constant; constant = constant->right)
+            {
+                out << "    rt.data(" << toValue(expression(constant)) << ");" << endl;
+                hasData = true;
+            }
+        }
+    }
+    if (hasData) out << endl;
+
+    out << m_body.str();
+
+    if (m_labels.find("finish") != m_labels.end()) out << "finish:" << endl;
+    out << "    console.terminate();" << endl;
+    out << "    return 0;" << endl;
+
+    if (m_usesDispatch)
+    {
+        out << endl;
+        out << "dispatch:" << endl;
+        out << "    switch (target)" << endl;
+        out << "    {" << endl;
+        for (map<int, ProgramLine *>::iterator it = m_program.begin(); it != m_program.end(); it++)
+        {
+            out << "        case " << it->first << ": goto " << lineLabel(it->first) << ";" << endl;
+        }
+        out << "        default: rt.error(\"Invalid line number in GOTO/GOSUB\");" << endl;
+        out << "    }" << endl;
+    }
+
+    if (m_usesResume)
+    {
+        out << endl;
+        out << "resume:" << endl;
+        out << "    switch (point)" << endl;
+        out << "    {" << endl;
+        for (int i = 0; i < m_points; i++)
+        {
+            out << "        case " << i << ": goto point_" << i << ";" << endl;
+        }
+        out << "        default: rt.error(\"Invalid resume point\");" << endl;
+        out << "    }" << endl;
+    }
+
+    out << "}" << endl;
+}
+
+void Translator::scan(Node *node)
+{
+    if (!node || node->type == nt_open) return;
+
+    if ((node->type == nt_identifier || node->type == nt_assign) && node->text != "" &&
+        !(node->right && node->right->type == nt_arrayid))
+    {
+        m_scalars.insert(lower(node->text));
+    }
+    if (node->type == nt_for && node->left && node->left->type == nt_identifier)
+    {
+        m_forVariables.insert(node->left->text);
+    }
+    if (node->type == nt_return || node->type == nt_next) m_usesResume = true;
+
+    // GET and PUT are translated using the program's (last) FIELD statement
+    // for their file number, since the variables have to be known here
+    if (node->type == nt_field && node->right) m_fieldLayouts[stoi(node->right->text)] = node;
+
+    scan(node->left);
+
+    // A GOSUB node's right points back at its own statement
+    if (node->type != nt_gosub) scan(node->right);
+}
+
+void Translator::generate()
+{
+    m_body.str("");
+    m_indent = 1;
+    m_points = 0;
+
+    for (map<int, ProgramLine *>::iterator it = m_program.begin(); it != m_program.end(); it++)
+    {
+        map<int, ProgramLine *>::iterator next = it;
+        next++;
+        m_nextLabel = (next == m_program.end() ? "finish" : lineLabel(next->first));
+
+        label(lineLabel(it->first));
+        emit("rt.currLine = " + to_string(it->first) + ";");
+        emit("ifState = ifs_none;");
+        emit("triggerElse = false;");
+
+        m_linePoints.clear();
+        for (Node *currNode = it->second->node->left; currNode; currNode = currNode->right)
+        {
+            statement(currNode, false);
+        }
+
+        // GOSUB and FOR inside THEN/ELSE resume at the following line
+        for (vector<int>::iterator point = m_linePoints.begin(); point != m_linePoints.end(); point++)
+        {
+            label("point_" + to_string(*point));
+        }
+    }
+}
+
+void Translator::emit(const string &line)
+{
+    m_body << string(m_indent * 4, ' ') << line << endl;
+}
+
+void Translator::label(const string &name)
+{
+    if (m_firstPass || m_labels.find(name) != m_labels.end()) m_body << name << ":" << endl;
+}
+
+string Translator::jump(const string &name)
+{
+    if (m_firstPass) m_labels.insert(name);
+    return "goto " + name + ";";
+}
+
+string Translator::lineLabel(int lineNum)
+{
+    return "line_" + to_string(lineNum);
+}
+
+int Translator::newPoint(bool nested)
+{
+    int result = m_points++;
+    if (nested) m_linePoints.push_back(result);
+    else m_statementPoint = result;
+    return result;
+}
+
+void Translator::statement(Node *node, bool nested)
+{
+    if (!node || !node->left) return;
+
+    Node *stmt = node->left;
+    switch (stmt->type)
+    {
+        case nt_print: case nt_scnclr: case nt_assign: case nt_clear: case nt_return:
+        case nt_if: case nt_for: case nt_next: case nt_input: case nt_open: case nt_close: case nt_flush:
+        case nt_field: case nt_get: case nt_put:
+        case nt_printfile: case nt_inputfile: case nt_matinput: case nt_getkey: case nt_read: case nt_restore:
+        case nt_goto: case nt_gosub: case nt_end:
+            break;
+        case nt_else:
+            emit("if (ifState == ifs_yes)");
+            emit("{");
+            m_indent++;
+            emit("ifState = ifs_none;");
+            emit(jump(m_nextLabel));
+            m_indent--;
+            emit("}");
+            emit("if (triggerElse)");
+            emit("{");
+            m_indent++;
+            emit("ifState = ifs_none;");
+            emit("triggerElse = false;");
+            statement(stmt->left, true);
+            m_indent--;
+            emit("}");
+            return;
+        default:
+            // DATA, REM and DIM do nothing at run time; TRON and TROFF
+            // only mean something to the interpreter
+            return;
+    }
+
+    if (!nested) m_statementPoint = -1;
+    emit("if (ifState != ifs_no || !triggerElse)");
+    emit("{");
+    m_indent++;
+    statementBody(stmt, nested);
+    m_indent--;
+    emit("}");
+
+    // A FOR or GOSUB resumes with the statement that follows it
+    if (!nested && m_statementPoint >= 0) label("point_" + to_string(m_statementPoint));
+}
+
+void Translator::statementBody(Node *node, bool nested)
+{
+    string s;
+    switch (node->type)
+    {
+        case nt_print:
+            print(node);
+            break;
+        case nt_scnclr:
+            emit("rt.console->clearText();");
+            break;
+        case nt_assign:
+            assign(node);
+            break;
+        case nt_clear:
+            clear();
+            break;
+        case nt_return:
+            emit("point = rt.return_();");
+            emit("goto resume;");
+            break;
+        case nt_if:
+            emit("bool condition = " + truth(expression(node->left)) + ";");
+            emit("ifState = (condition ? ifs_yes : ifs_no);");
+            emit("triggerElse = !condition;");
+            statement(node->right, true);
+            break;
+        case nt_for:
+            for_(node, nested);
+            break;
+        case nt_next:
+            next(node);
+            break;
+        case nt_input:
+            s = (node->right ? literal(node->right->text) : "\"\"");
+            emit("Value v = rt.input(" + s + ", " + (isStringName(node->left->text) ? "true" : "false") + ");");
+            emit(store(node->left, "v", k_value));
+            break;
+        case nt_inputfile:
+            emit("Value v = rt.inputFile(" + to_string(stoi(node->right->text)) + ", " +
+                (isStringName(node->left->text) ? "true" : "false") + ");");
+            emit(store(node->left, "v", k_value));
+            break;
+        case nt_matinput:
+            emit("rt.matInput(" + to_string(stoi(node->right->text)) + ", " + literal(node->left->text) + ", " +
+                (isStringName(node->left->text) ? "true" : "false") + ");");
+            break;
+        case nt_getkey:
+            if (!node->left) break;
+            m_inAssign = true;
+            emit("Value v = rt.getKey();");
+            emit(store(node->left, "v", k_value));
+            m_inAssign = false;
+            break;
+        case nt_read:
+            for (Node *currNode = node->left; currNode; currNode = currNode->right)
+            {
+                emit("{");
+                m_indent++;
+                emit("Value v = rt.read();");
+                emit(store(currNode->left, "v", k_value));
+                m_indent--;
+                emit("}");
+            }
+            break;
+        case nt_restore:
+            emit("rt.restore();");
+            break;
+        case nt_open:
+            if (node->right->left->type == nt_input) s = "ra_input";
+            else if (node->right->left->type == nt_output) s = (node->right->left->data == "async" ? "ra_output, 128, true" : "ra_output");
+            else s = "ra_random, " + to_string(node->right->left->left ? stoi(node->right->left->left->text) : 128);
+            emit("rt.open(" + literal(node->left->text) + ", " + to_string(stoi(node->right->right->text)) + ", " + s + ");");
+            break;
+        case nt_field:
+            for (Node *currNode = node->left; currNode; currNode = currNode->right)
+            {
+                s += (s.empty() ? "" : ", ") + to_string(stoi(currNode->text));
+            }
+            emit("rt.field(" + to_string(stoi(node->right->text)) + ", {" + s + "});");
+            break;
+        case nt_get:
+        case nt_put:
+            record(node);
+            break;
+        case nt_close:
+            emit("rt.close(" + to_string(stoi(node->left->text)) + ");");
+            break;
+        case nt_flush:
+            if (node->right && lower(node->right->text) != "every") emit("rt.error(" + literal("Expected # or EVERY; found \"" + node->right->text + "\"") + ");");
+            else if (node->right) emit("rt.flushEvery(" + to_string(stoi(node->left->text)) + ");");
+            else if (node->left) emit("rt.flush(" + to_string(stoi(node->left->text)) + ");");
+            else emit("rt.flushAll();");
+            break;
+        case nt_printfile:
+            printfile(node);
+            break;
+        case nt_goto:
+            goto_(node, false, nested);
+            break;
+        case nt_gosub:
+            goto_(node, true, nested);
+            break;
+        case nt_end:
+            emit(jump("finish"));
+            break;
+        default:
+            break;
+    }
+}
+
+void Translator::print(Node *node)
+{
+    if (!node->left)
+    {
+        emit("rt.console->addText(\"\");");
+        return;
+    }
+
+    bool at = (node->right && node->right->type == nt_at);
+    bool using_ = (node->right && node->right->type == nt_using);
+    if (at)
+    {
+        emit("Value at = " + toValue(expression(node->right->left)) + ";");
+        emit("if (!at.isInteger()) rt.error(\"Type mismatch for PRINT @\");");
+        emit("int loc = at.integer();");
+    } else if (using_)
+    {
+        emit("Value format = " + toValue(expression(node->right->left)) + ";");
+        emit("if (!format.isString()) rt.error(\"Type mismatch for PRINT USING\");");
+    }
+
+    for (Node *currNode = node->left; currNode; currNode = currNode->right)
+    {
+        string pmode = "pam_none";
+        if (currNode->data == "append") pmode = "pam_append";
+        else if (currNode->data == "append-tab") pmode = "pam_tab";
+
+        string s = toString(expression(currNode->left));
+        if (using_) s = "formatString(" + s + ", format.string())";
+
+        if (at)
+        {
+            emit("{");
+            m_indent++;
+            emit("string s = " + s + ";");
+            emit("rt.console->putTextAt(loc, s, " + pmode + ");");
+            emit("loc += s.size();");
+            m_indent--;
+            emit("}");
+        } else
+        {
+            emit("rt.console->addText(" + s + ", " + pmode + ");");
+        }
+    }
+}
+
+void Translator::printfile(Node *node)
+{
+    bool append = false;
+    emit("string s = \"\";");
+    for (Node *currNode = node->left; currNode; currNode = currNode->right)
+    {
+        append = (currNode->data == "append");
+        emit("s += " + toString(expression(currNode->left)) + ";");
+    }
+    emit("rt.printFile(" + to_string(stoi(node->right->text)) + ", s, " + (append ? "true" : "false") + ");");
+}
+
+void Translator::record(Node *node)
+{
+    int number = stoi(node->right->text);
+    string n = to_string(number);
+    string rec = (node->left ? toValue(expression(node->left)) : "Value()");
+
+    map<int, Node *>::iterator layout = m_fieldLayouts.find(number);
+    Node *fields = (layout == m_fieldLayouts.end() ? nullptr : layout->second->left);
+
+    if (node->type == nt_get)
+    {
+        emit("rt.get(" + n + ", " + rec + ");");
+        int index = 0;
+        for (Node *currNode = fields; currNode; currNode = currNode->right, index++)
+        {
+            emit("{");
+            m_indent++;
+            emit("Value v;");
+            emit("if (rt.fieldValue(" + n + ", " + to_string(index) + ", " +
+                (isStringName(currNode->left->text) ? "true" : "false") + ", v))");
+            emit("{");
+            m_indent++;
+            emit(store(currNode->left, "v", k_value));
+            m_indent--;
+            emit("}");
+            m_indent--;
+            emit("}");
+        }
+    } else
+    {
+        int index = 0;
+        for (Node *currNode = fields; currNode; currNode = currNode->right, index++)
+        {
+            emit("rt.setField(" + n + ", " + to_string(index) + ", " + toValue(variable(currNode->left)) + ");");
+        }
+        emit("rt.put(" + n + ", " + rec + ");");
+    }
+}
+
+void Translator::assign(Node *node)
+{
+    if (!node->left) return;
+
+    m_inAssign = true;
+    if (node->left->type == nt_inkey)
+    {
+        emit("Value v = rt.inkey();");
+        emit(store(node, "v", k_value));
+    } else
+    {
+        Code code = expression(node->left);
+        if (node->valueType != vt_null)
+        {
+            // TypeInference has proven the assignment type-safe
+            if (code.kind == k_integer && isIntegerScalar(node->text) && !(node->right && node->right->type == nt_arrayid))
+            {
+                emit(store(node, code.text, k_integer));
+            } else
+            {
+                emit("Value v = " + toValue(code) + ";");
+                emit(store(node, "v", k_value));
+            }
+        } else
+        {
+            emit("Value v = " + toValue(code) + ";");
+            emit(string("rt.checkAssign(v, ") + (isStringName(node->text) ? "true" : "false") + ");");
+            emit(store(node, "v", k_value));
+        }
+    }
+    m_inAssign = false;
+}
+
+void Translator::goto_(Node *node, bool gosub, bool nested)
+{
+    string name = (gosub ? "GOSUB" : "GOTO");
+    if (gosub) emit("rt.gosub(" + to_string(newPoint(nested)) + ");");
+
+    if (node->left && node->left->type == nt_integer)
+    {
+        int lineNum = stoi(node->left->text);
+        if (m_program.find(lineNum) != m_program.end()) emit(jump(lineLabel(lineNum)));
+        else emit("rt.error(\"Invalid line number in GOTO/GOSUB\");");
+        return;
+    }
+
+    m_usesDispatch = true;
+    emit("Value v = " + toValue(expression(node->left)) + ";");
+    emit("if (!v.isInteger()) rt.error(\"Invalid value for " + name + ": \\\"\" + v.string() + \"\\\"\");");
+    emit("target = v.integer();");
+    emit("goto dispatch;");
+}
+
+void Translator::for_(Node *node, bool nested)
+{
+    emit("Value from = " + toValue(expression(node->right->left)) + ";");
+    emit("Value to = " + toValue(expression(node->right->right)) + ";");
+    emit("int start = rt.for_(" + literal(node->left->text) + ", from, to, " + to_string(newPoint(nested)) + ");");
+    emit(store(node->left, "start", k_integer));
+}
+
+void Translator::next(Node *node)
+{
+    if (node->left)
+    {
+        string var = literal(node->left->text);
+        emit("RuntimeFor &f = rt.next(" + var + ");");
+        emit("int value = " + toInteger(variable(node->left)) + ";");
+        emit(store(node->left, "value + 1", k_integer));
+        emit("if (f.endIndex > value)");
+        emit("{");
+        emit("    point = f.resumePoint;");
+        emit("    goto resume;");
+        emit("}");
+        emit("rt.endFor(" + var + ");");
+        return;
+    }
+
+    // Without a variable, NEXT closes the innermost FOR, whichever that is
+    emit("string var = rt.innerFor();");
+    emit("RuntimeFor &f = rt.next(var);");
+    emit("int value = 0;");
+    for (set<string>::iterator it = m_forVariables.begin(); it != m_forVariables.end(); it++)
+    {
+        Node id(nt_identifier, *it);
+        emit(string(it == m_forVariables.begin() ? "" : "else ") + "if (var == " + literal(*it) + ")");
+        emit("{");
+        m_indent++;
+        emit("value = " + toInteger(variable(&id)) + ";");
+        emit(store(&id, "value + 1", k_integer));
+        m_indent--;
+        emit("}");
+    }
+    emit("if (f.endIndex > value)");
+    emit("{");
+    emit("    point = f.resumePoint;");
+    emit("    goto resume;");
+    emit("}");
+    emit("rt.endFor(var);");
+}
+
+void Translator::clear()
+{
+    for (set<string>::iterator it = m_scalars.begin(); it != m_scalars.end(); it++)
+    {
+        if (isIntegerScalar(*it)) emit(scalarName(*it) + " = 0;");
+        else emit(scalarName(*it) + " = Value(0);");
+    }
+    emit("rt.clear();");
+}
+
+string Translator::store(Node *target, const string &value, Kind kind)
+{
+    if (!target || target->text == "") return ";";
+
+    if (target->right && target->right->type == nt_arrayid)
+    {
+        return "rt.setElement(" + arrayKey(target) + ", " + toValue(Code(value, kind)) + ");";
+    }
+
+    if (isIntegerScalar(target->text)) return scalarName(target->text) + " = " + toInteger(Code(value, kind)) + ";";
+    return scalarName(target->text) + " = " + toValue(Code(value, kind)) + ";";
+}
+
+Translator::Code Translator::variable(Node *node)
+{
+    if (node->right && node->right->type == nt_arrayid)
+    {
+        return Code("rt.element(" + arrayKey(node) + ")", k_value);
+    }
+
+    m_readScalars.insert(lower(node->text));
+    return Code(scalarName(node->text), (isIntegerScalar(node->text) ? k_integer : k_value));
+}
+
+string Translator::arrayKey(Node *node)
+{
+    string result = "Runtime::key(" + literal(node->text) + ", {";
+    for (Node *index = node->right; index && index->type == nt_arrayid; index = index->right)
+    {
+        result += (index == node->right ? "" : ", ") + toValue(expression(index->left));
+    }
+    return result + "})";
+}
+
+string Translator::scalarName(const string &id)
+{
+    // Keep the mapping one-to-one: "a$" and "a_s" must not collide
+    string result = "v_";
+    for (unsigned char c : lower(id))
+    {
+        if (isalnum(c)) result += c;
+        else if (c == '_') result += "__";
+        else if (c == '$') result += "_S";
+        else if (c == '%') result += "_I";
+        else
+        {
+            ostringstream oss;
+            oss << "_X" << hex << int(c);
+            result += oss.str();
+        }
+    }
+    return result;
+}
+
+bool Translator::isIntegerScalar(const string &id)
+{
+    return m_typeInference.variableType(id) == vt_integer;
+}
+
+bool Translator::isStringName(const string &id)
+{
+    return (id.size() > 1 && id.back() == '$');
+}
+
+string Translator::lower(string s)
+{
+    transform(s.begin(), s.end(), s.begin(), [](unsigned char c){ return tolower(c); });
+    return s;
+}
+
+string Translator::literal(const string &s)
+{
+    ostringstream result;
+    result << '"';
+    for (unsigned char c : s)
+    {
+        if (c == '"' || c == '\\') result << '\\' << c;
+        else if (isprint(c)) result << c;
+        else result << '\\' << oct << setw(3) << setfill('0') << int(c) << dec;
+    }
+    result << '"';
+    return result.str();
+}
+
+// The expression translators below mirror System::expression, System::add,
+// the typed kernels and System::boolExpression case for case
+
+Translator::Code Translator::expression(Node *node)
+{
+    if (!node) return Code("Value()", k_value);
+
+    if (node->type == nt_string) return Code("Value(string(" + literal(node->text) + "))", k_value);
+    if (node->type == nt_integer) return Code(to_string(stoi(node->text)), k_integer);
+    if (node->type == nt_real) return Code("float(" + node->text + ")", k_real);
+    if (node->type == nt_function) return function(node);
+
+    if (node->type == nt_and || node->type == nt_or || node->type == nt_not ||
+        (!m_inAssign && node->type == nt_equal) || node->type == nt_notequal || node->type == nt_greater ||
+        node->type == nt_greaterequal || node->type == nt_less || node->type == nt_lessequal)
+    {
+        return Code(boolean(node), k_bool);
+    }
+
+    return add(node);
+}
+
+bool isArithmeticType(NodeType type)
+{
+    return (type == nt_add || type == nt_minus || type == nt_mult || type == nt_div ||
+            type == nt_negate || type == nt_power);
+}
+
+Translator::Code Translator::add(Node *node)
+{
+    if (node->valueType == vt_integer && isArithmeticType(node->type)) return Code(integer(node), k_integer);
+    if (node->valueType == vt_real && isArithmeticType(node->type)) return Code(real(node), k_real);
+
+    if (node->type == nt_integer || node->type == nt_real || node->type == nt_string) return expression(node);
+    if (node->type == nt_identifier) return variable(node);
+    if (node->type == nt_function) return function(node);
+
+    if (node->type == nt_negate) return Code("rt.checked(" + toValue(add(node->left)) + ".negate())", k_value);
+
+    string method = "";
+    if (node->type == nt_add) method = "add";
+    else if (node->type == nt_minus) method = "subtract";
+    else if (node->type == nt_mult) method = "multiply";
+    else if (node->type == nt_div) method = "divide";
+    else if (node->type == nt_power) method = "power";
+    if (method == "") return Code("rt.checked(Value())", k_value);
+
+    return Code("rt.checked(" + toValue(add(node->left)) + "." + method + "(" + toValue(add(node->right)) + "))", k_value);
+}
+
+string Translator::integer(Node *node)
+{
+    switch (node->type)
+    {
+        case nt_add:
+            return "(" + integer(node->left) + " + " + integer(node->right) + ")";
+        case nt_minus:
+            return "(" + integer(node->left) + " - " + integer(node->right) + ")";
+        case nt_mult:
+            return "(" + integer(node->left) + " * " + integer(node->right) + ")";
+        case nt_negate:
+            return "(" + integer(node->left) + " * -1)";
+        default:
+            return toInteger(add(node));
+    }
+}
+
+string Translator::real(Node *node)
+{
+    if (node->valueType == vt_integer) return "float(" + integer(node) + ")";
+
+    switch (node->type)
+    {
+        case nt_add:
+            return "(" + real(node->left) + " + " + real(node->right) + ")";
+        case nt_minus:
+            return "(" + real(node->left) + " - " + real(node->right) + ")";
+        case nt_mult:
+            return "(" + real(node->left) + " * " + real(node->right) + ")";
+        case nt_div:
+            return "(" + real(node->left) + " / " + real(node->right) + ")";
+        case nt_negate:
+            return "float(" + real(node->left) + " * -1.0)";
+        case nt_power:
+            return "float(pow(double(" + real(node->left) + "), double(" + real(node->right) + ")))";
+        default:
+            return toReal(add(node));
+    }
+}
+
+bool isNumericValueType(ValueType type)
+{
+    return (type == vt_integer || type == vt_real);
+}
+
+string Translator::boolean(Node *node)
+{
+    if (!node) return "false";
+    if (node->type == nt_string)
+        return "(rt.error(" + literal("Type mismatch: Expecting boolean, found \"" + node->text + "\"") + "), false)";
+
+    if (node->type == nt_integer) return (stoi(node->text) != 0 ? "true" : "false");
+    if (node->type == nt_real) return (stof(node->text) != 0.0 ? "true" : "false");
+    if (node->type == nt_identifier) return toValue(variable(node)) + ".boolean()";
+
+    // Both sides are always evaluated, as in System::boolExpression
+    if (node->type == nt_and) return "bool(" + boolean(node->left) + " & " + boolean(node->right) + ")";
+    if (node->type == nt_or) return "bool(" + boolean(node->left) + " | " + boolean(node->right) + ")";
+    if (node->type == nt_not) return "!" + boolean(node->left);
+
+    if (node->left && node->right &&
+        isNumericValueType(node->left->valueType) && isNumericValueType(node->right->valueType))
+    {
+        string op = "";
+        if (node->type == nt_equal) op = " == ";
+        else if (node->type == nt_notequal) op = " != ";
+        else if (node->type == nt_greater) op = " > ";
+        else if (node->type == nt_less) op = " < ";
+        else if (node->type == nt_greaterequal) op = " >= ";
+        else if (node->type == nt_lessequal) op = " <= ";
+        if (op != "") return "(" + real(node->left) + op + real(node->right) + ")";
+    }
+
+    if (!node->left || !node->right) return "false";
+
+    string v1 = toValue(add(node->left));
+    string v2 = toValue(add(node->right));
+    if (node->type == nt_equal) return v1 + ".equals(" + v2 + ")";
+    if (node->type == nt_greater) return v1 + ".isGreaterThan(" + v2 + ")";
+    if (node->type == nt_less) return v1 + ".isLessThan(" + v2 + ")";
+    if (node->type == nt_notequal) return "!" + v1 + ".equals(" + v2 + ")";
+    if (node->type == nt_greaterequal) return "Runtime::greaterEqual(" + v1 + ", " + v2 + ")";
+    if (node->type == nt_lessequal) return "Runtime::lessEqual(" + v1 + ", " + v2 + ")";
+
+    return "false";
+}
+
+Translator::Code Translator::function(Node *node)
+{
+    return Code("rt.function(" + literal(lower(node->text)) + ", " + toValue(expression(node->left)) + ")", k_value);
+}
+
+string Translator::toValue(const Code &code)
+{
+    if (code.kind == k_bool) return "Value(bool(" + code.text + "))";
+    if (code.kind == k_value) return code.text;
+    return "Value(" + code.text + ")";
+}
+
+string Translator::toInteger(const Code &code)
+{
+    if (code.kind == k_integer) return code.text;
+    if (code.kind == k_real) return "int(" + code.text + ")";
+    if (code.kind == k_bool) return "(" + code.text + " ? 1 : 0)";
+    return code.text + ".integer()";
+}
+
+string Translator::toReal(const Code &code)
+{
+    if (code.kind == k_real) return code.text;
+    if (code.kind == k_integer) return "float(" + code.text + ")";
+    if (code.kind == k_bool) return "(" + code.text + " ? float(1.0) : float(0.0))";
+    return code.text + ".real()";
+}
+
+string Translator::truth(const Code &code)
+{
+    if (code.kind == k_bool) return code.text;
+    if (code.kind == k_integer) return "(" + code.text + " != 0)";
+    if (code.kind == k_real) return "(" + code.text + " != 0.0)";
+    return code.text + ".boolean()";
+}
+
+string Translator::toString(const Code &code)
+{
+    if (code.kind == k_integer) return "to_string(" + code.text + ")";
+    return toValue(code) + ".string()";
+}
@@ -0,0 +1,112 @@
+#ifndef _TRANSLATOR_HPP_
+#define _TRANSLATOR_HPP_
+
+#include "Parser.hpp"
+#include "TypeInference.hpp"
+
+#include <map>
+#include <set>
+#include <vector>
+#include <sstream>
+
+struct ProgramLine;
+
+/*
+ * Ahead-of-time translation of a BASIC program into one C++ function.
+ * Every program line becomes a label and literal GOTO/GOSUB targets become
+ * plain gotos; computed targets, RETURN and NEXT go through switch
+ * statements over line numbers and numbered resume points.  Variables that
+ * TypeInference proves integer-only are C++ ints, everything else is a
+ * Value.  The output is linked against Runtime and TerminalConsole.
+ */
+class Translator {
+public:
+    Translator() {}
+    ~Translator();
+
+    bool load(istream &in);
+    void translate(ostream &out, const string &source);
+    vector<string> errors() const { return m_errors; }
+
+private:
+    enum Kind { k_integer, k_real, k_bool, k_value };
+
+    struct Code {
+        string text;
+        Kind kind;
+
+        Code(string text, Kind kind)
+        {
+            this->text = text;
+            this->kind = kind;
+        }
+    };
+
+    map<int, ProgramLine *> m_program;
+    vector<string> m_errors;
+    TypeInference m_typeInference;
+
+    set<string> m_scalars;
+    set<string> m_readScalars;          // Scalars some expression reads; found by the first pass
+    set<string> m_forVariables;
+    map<int, Node *> m_fieldLayouts;     // The FIELD statement for each file number
+    bool m_usesResume = false;
+
+    // Generation runs twice; the first pass only records which labels are
+    // jumped to, so the second can leave out the rest
+    bool m_firstPass = true;
+    set<string> m_labels;
+    bool m_usesDispatch = false;
+
+    ostringstream m_body;
+    int m_indent = 1;
+    int m_points = 0;
+    vector<int> m_linePoints;
+    int m_statementPoint = -1;
+    string m_nextLabel;
+    bool m_inAssign = false;
+
+    void scan(Node *node);
+    void generate();
+
+    void emit(const string &line);
+    void label(const string &name);
+    string jump(const string &name);
+    string lineLabel(int lineNum);
+    int newPoint(bool nested);
+
+    void statement(Node *node, bool nested);
+    void statementBody(Node *node, bool nested);
+    void print(Node *node);
+    void printfile(Node *node);
+    void record(Node *node);
+    void assign(Node *node);
+    void goto_(Node *node, bool gosub, bool nested);
+    void for_(Node *node, bool nested);
+    void next(Node *node);
+    void clear();
+
+    string store(Node *target, const string &value, Kind kind);
+    Code variable(Node *node);
+    string scalarName(const string &id);
+    bool isIntegerScalar(const string &id);
+    static bool isStringName(const string &id);
+    static string lower(string s);
+    static string literal(const string &s);
+
+    Code expression(Node *node);
+    Code add(Node *node);
+    string integer(Node *node);
+    string real(Node *node);
+    string boolean(Node *node);
+    Code function(Node *node);
+    string arrayKey(Node *node);
+
+    static string toValue(const Code &code);
+    static string toInteger(const Code &code);
+    static string toReal(const Code &code);
+    static string toString(const Code &code);
+    static string truth(const Code &code);
+};
+
+#endif
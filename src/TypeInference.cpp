@@ -0,0 +1,278 @@
+#include "TypeInference.hpp"
+#include "System.hpp"
+
+#include <algorithm>
+
+void TypeInference::analyze(const map<int, ProgramLine *> &program, const map<string, Value> &variables)
+{
+    m_types.clear();
+
+    // Variables left over from immediate mode or a previous RUN keep their
+    // current values, so their runtime type is the starting point
+    for (map<string, Value>::const_iterator it = variables.begin(); it != variables.end(); it++)
+    {
+        assignType(it->first, it->second.type());
+    }
+
+    for (map<int, ProgramLine *>::const_iterator it = program.begin(); it != program.end(); it++)
+    {
+        clear(it->second->node);
+    }
+
+    // Types only ever widen, so this settles within a few passes; the last
+    // pass (with no changes) leaves every node annotated with its final type
+    do
+    {
+        m_changed = false;
+        for (map<int, ProgramLine *>::const_iterator it = program.begin(); it != program.end(); it++)
+        {
+            if (!it->second->node) continue;
+
+            Node *currNode = it->second->node->left;
+            while (currNode)
+            {
+                statement(currNode);
+                currNode = currNode->right;
+            }
+        }
+    } while (m_changed);
+}
+
+string TypeInference::variableName(const string &id)
+{
+    string result = id.substr(0, id.find("__"));
+    transform(result.begin(), result.end(), result.begin(),
+    [](unsigned char c){ return tolower(c); });
+    return result;
+}
+
+bool TypeInference::isStringName(const string &id)
+{
+    return (id.size() > 1 && id.back() == '$');
+}
+
+ValueType TypeInference::join(ValueType t1, ValueType t2)
+{
+    if (t1 == t2) return t1;
+    if ((t1 == vt_integer || t1 == vt_real) && (t2 == vt_integer || t2 == vt_real)) return vt_real;
+    return vt_null;
+}
+
+ValueType TypeInference::variableType(const string &id)
+{
+    string name = variableName(id);
+    if (isStringName(name)) return vt_string;
+
+    // Variables that are never assigned read as 0
+    map<string, ValueType>::iterator it = m_types.find(name);
+    if (it == m_types.end()) return vt_integer;
+    return it->second;
+}
+
+void TypeInference::assignType(const string &id, ValueType type)
+{
+    string name = variableName(id);
+    if (isStringName(name)) return;
+
+    if (type != vt_integer && type != vt_real) type = vt_null;
+
+    map<string, ValueType>::iterator it = m_types.find(name);
+    if (it == m_types.end())
+    {
+        m_types[name] = type;
+        m_changed = true;
+    } else if (join(it->second, type) != it->second)
+    {
+        it->second = join(it->second, type);
+        m_changed = true;
+    }
+}
+
+void TypeInference::clear(Node *node)
+{
+    if (!node) return;
+
+    node->valueType = vt_null;
+    clear(node->left);
+
+    // A GOSUB node's right points back at its own statement
+    if (node->type != nt_gosub) clear(node->right);
+}
+
+void TypeInference::statement(Node *node)
+{
+    if (!node || !node->left) return;
+
+    Node *stmt = node->left;
+    Node *currNode = nullptr;
+    switch (stmt->type)
+    {
+        case nt_assign:
+        {
+            ValueType type = (stmt->left ? expression(stmt->left) : vt_null);
+            target(stmt, type);
+            if (!isStringName(stmt->text) && (type == vt_integer || type == vt_real)) stmt->valueType = type;
+            break;
+        }
+        case nt_print:
+        case nt_printfile:
+            if (stmt->right) expression(stmt->right->left);
+            currNode = stmt->left;
+            while (currNode)
+            {
+                expression(currNode->left);
+                currNode = currNode->right;
+            }
+            break;
+        case nt_if:
+            expression(stmt->left);
+            statement(stmt->right);
+            break;
+        case nt_else:
+            statement(stmt->left);
+            break;
+        case nt_for:
+            expression(stmt->right->left);
+            expression(stmt->right->right);
+            target(stmt->left, vt_integer);
+            break;
+        case nt_input:
+            target(stmt->left, (isStringName(stmt->left->text) ? vt_string : vt_real));
+            break;
+        case nt_inputfile:
+        case nt_matinput:
+            target(stmt->left, (isStringName(stmt->left->text) ? vt_string : vt_real));
+            break;
+        case nt_getkey:
+            target(stmt->left, vt_string);
+            break;
+        case nt_field:
+            // GET assigns every FIELD variable from the record
+            for (currNode = stmt->left; currNode; currNode = currNode->right)
+            {
+                target(currNode->left, (isStringName(currNode->left->text) ? vt_string : vt_real));
+            }
+            break;
+        case nt_read:
+            // DATA constants are always held as strings
+            currNode = stmt->left;
+            while (currNode)
+            {
+                target(currNode->left, vt_string);
+                currNode = currNode->right;
+            }
+            break;
+        case nt_dim:
+            currNode = stmt->left;
+            while (currNode)
+            {
+                for (Node *index = currNode->left->right; index; index = index->right) expression(index->left);
+                currNode = currNode->right;
+            }
+            break;
+        case nt_goto:
+        case nt_gosub:
+        case nt_open:
+        case nt_get:
+        case nt_put:
+            expression(stmt->left);
+            break;
+        default:
+            break;
+    }
+}
+
+void TypeInference::target(Node *node, ValueType type)
+{
+    if (!node) return;
+
+    for (Node *index = node->right; index && index->type == nt_arrayid; index = index->right)
+    {
+        expression(index->left);
+    }
+    assignType(node->text, type);
+}
+
+ValueType TypeInference::expression(Node *node)
+{
+    if (!node) return vt_null;
+
+    ValueType result = vt_null;
+    ValueType t1, t2;
+    switch (node->type)
+    {
+        case nt_integer:
+            result = vt_integer;
+            break;
+        case nt_real:
+            result = vt_real;
+            break;
+        case nt_string:
+        case nt_inkey:
+            result = vt_string;
+            break;
+        case nt_identifier:
+            for (Node *index = node->right; index && index->type == nt_arrayid; index = index->right)
+            {
+                expression(index->left);
+            }
+            result = variableType(node->text);
+            break;
+        case nt_function:
+            expression(node->left);
+            result = function(node);
+            break;
+        case nt_add:
+            t1 = expression(node->left);
+            t2 = expression(node->right);
+            if (t1 == vt_string && t2 == vt_string) result = vt_string;
+            else result = join(t1, t2);
+            break;
+        case nt_minus:
+        case nt_mult:
+            t1 = expression(node->left);
+            t2 = expression(node->right);
+            result = join(t1, t2);
+            if (result == vt_string) result = vt_null;
+            break;
+        case nt_div:
+        case nt_power:
+            t1 = expression(node->left);
+            t2 = expression(node->right);
+            if (join(t1, t2) == vt_integer || join(t1, t2) == vt_real) result = vt_real;
+            break;
+        case nt_negate:
+            t1 = expression(node->left);
+            if (t1 == vt_integer || t1 == vt_real) result = t1;
+            break;
+        case nt_and:
+        case nt_or:
+        case nt_not:
+        case nt_equal:
+        case nt_notequal:
+        case nt_greater:
+        case nt_greaterequal:
+        case nt_less:
+        case nt_lessequal:
+            expression(node->left);
+            expression(node->right);
+            result = vt_bool;
+            break;
+        default:
+            break;
+    }
+
+    node->valueType = result;
+    return result;
+}
+
+ValueType TypeInference::function(Node *node)
+{
+    string ltext = node->text;
+    transform(ltext.begin(), ltext.end(), ltext.begin(), [](unsigned char c){ return tolower(c); });
+
+    if (ltext == "int" || ltext == "lof" || ltext == "loc" || ltext == "num") return vt_integer;
+    if (ltext == "rnd" || ltext == "val") return vt_real;
+    if (ltext == "str$" || ltext == "chr$" || ltext == "tab") return vt_string;
+    return vt_null;
+}
@@ -0,0 +1,42 @@
+#ifndef _TYPEINFERENCE_HPP_
+#define _TYPEINFERENCE_HPP_
+
+#include "Parser.hpp"
+#include "Value.hpp"
+
+#include <map>
+
+struct ProgramLine;
+
+/*
+ * Classifies every variable in a program as string, integer-only or real by
+ * following the $ suffix, literal types and the flow of assignments, then
+ * annotates each expression node with its result type (Node::valueType).
+ *
+ * Within the lattice vt_integer < vt_real < vt_null, vt_real means "any
+ * number" and vt_null means "unknown"; nodes left at vt_null are evaluated
+ * with the generic, tag-dispatched path in System.
+ */
+class TypeInference {
+public:
+    void analyze(const map<int, ProgramLine *> &program, const map<string, Value> &variables);
+    ValueType variableType(const string &id);
+
+private:
+    map<string, ValueType> m_types;
+    bool m_changed = false;
+
+    static string variableName(const string &id);
+    static bool isStringName(const string &id);
+    static ValueType join(ValueType t1, ValueType t2);
+
+    void assignType(const string &id, ValueType type);
+
+    void clear(Node *node);
+    void statement(Node *node);
+    void target(Node *node, ValueType type);
+    ValueType expression(Node *node);
+    ValueType function(Node *node);
+};
+
+#endif
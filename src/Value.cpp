@@ -1,4 +1,8 @@
 #include "Value.hpp"
+#include "Counters.hpp"
+#include "Memory.hpp"
+
+#include <cmath>
 
 Value::Value() 
 {
@@ -17,6 +21,7 @@ Value::Value(std::string s)
     rvalue = 0.0;
     bvalue = false;
     m_type = vt_string;
+    tally(counters.stringValues);
 }
 
 Value::Value(int i) 
@@ -82,6 +87,59 @@ bool Value::isLessThan(const Value &v)
     else return false;
 }
 
+Value Value::add(const Value &v) const
+{
+    if (m_type == vt_integer && v.m_type == vt_integer) return Value(integer() + v.integer());    
+    if (m_type == vt_integer && v.m_type == vt_real) return Value(integer() + v.real());    
+    if (m_type == vt_real && v.m_type == vt_real) return Value(real() + v.real());    
+    if (m_type == vt_real && v.m_type == vt_integer) return Value(real() + v.integer());    
+    if (m_type == vt_string && v.m_type == vt_string) return Value(string() + v.string());   
+    return Value();
+}
+
+Value Value::subtract(const Value &v) const
+{
+    if (m_type == vt_integer && v.m_type == vt_integer) return Value(integer() - v.integer());    
+    if (m_type == vt_integer && v.m_type == vt_real) return Value(integer() - v.real());    
+    if (m_type == vt_real && v.m_type == vt_real) return Value(real() - v.real());    
+    if (m_type == vt_real && v.m_type == vt_integer) return Value(real() - v.integer());    
+    return Value();
+}
+
+Value Value::multiply(const Value &v) const
+{
+    if (m_type == vt_integer && v.m_type == vt_integer) return Value(integer() * v.integer());    
+    if (m_type == vt_integer && v.m_type == vt_real) return Value(integer() * v.real());    
+    if (m_type == vt_real && v.m_type == vt_real) return Value(real() * v.real());    
+    if (m_type == vt_real && v.m_type == vt_integer) return Value(real() * v.integer());    
+    return Value();
+}
+
+Value Value::divide(const Value &v) const
+{
+    if (m_type == vt_integer && v.m_type == vt_integer) return Value(float(integer()) / float(v.integer()));    
+    if (m_type == vt_integer && v.m_type == vt_real) return Value(float(integer()) / v.real());    
+    if (m_type == vt_real && v.m_type == vt_real) return Value(real() / v.real());    
+    if (m_type == vt_real && v.m_type == vt_integer) return Value(real() / float(v.integer()));    
+    return Value();
+}
+
+Value Value::power(const Value &v) const
+{
+    if (m_type == vt_integer && v.m_type == vt_integer) return Value(pow(integer(), v.integer()));    
+    if (m_type == vt_integer && v.m_type == vt_real) return Value(pow(integer(), v.real()));    
+    if (m_type == vt_real && v.m_type == vt_real) return Value(pow(real(), v.real()));    
+    if (m_type == vt_real && v.m_type == vt_integer) return Value(pow(real(), v.integer()));    
+    return Value();
+}
+
+Value Value::negate() const
+{
+    if (m_type == vt_integer) return Value(integer() * -1);    
+    if (m_type == vt_real) return Value(float(real() * -1.0));    
+    return Value();
+}
+
 string trimTrailingZeroes(float n)
 {
     std::string result = to_string(n);
@@ -153,3 +211,8 @@ float Value::real() const
             return 0.0;
     }
 }
+
+size_t Value::heapBytes() const
+{
+    return ::heapBytes(svalue);
+}
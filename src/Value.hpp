@@ -9,7 +9,7 @@ enum ValueType { vt_null, vt_string, vt_integer, vt_real, vt_bool };
 class Value {
     public:
         Value();
-        Value(string s);
+        Value(std::string s);
         Value(int i);
         Value(float f);
         Value(double f);
@@ -26,12 +26,23 @@ class Value {
         bool isGreaterThan(const Value &v);
         bool isLessThan(const Value &v);
 
-        string string() const;
+        // Arithmetic; each returns a null Value when the types don't mix
+        Value add(const Value &v) const;
+        Value subtract(const Value &v) const;
+        Value multiply(const Value &v) const;
+        Value divide(const Value &v) const;
+        Value power(const Value &v) const;
+        Value negate() const;
+
+        std::string string() const;
         bool boolean() const;
         int integer() const;
         float real() const;
         ValueType type() const { return m_type; }
 
+        // Bytes a string value has allocated beyond sizeof(Value)
+        size_t heapBytes() const;
+
     private:
         std::string svalue;
         int ivalue;
@@ -0,0 +1,46 @@
+#include "Translator.hpp"
+
+#include <iostream>
+#include <fstream>
+
+// kbasic-aot: translate a BASIC program into C++ source that links against
+// the kbasic runtime library.
+//
+//     kbasic-aot program.bas program.cpp
+
+int main(int argc, char **argv)
+{
+    if (argc != 3)
+    {
+        cerr << "Usage: kbasic-aot <program.bas> <output.cpp>" << endl;
+        return 2;
+    }
+
+    ifstream in(argv[1]);
+    if (!in.is_open())
+    {
+        cerr << "Unable to open file \"" << argv[1] << "\"" << endl;
+        return 1;
+    }
+
+    Translator translator;
+    if (!translator.load(in))
+    {
+        vector<string> errors = translator.errors();
+        for (vector<string>::iterator it = errors.begin(); it != errors.end(); it++)
+        {
+            cerr << *it << endl;
+        }
+        return 1;
+    }
+
+    ofstream out(argv[2]);
+    if (!out.is_open())
+    {
+        cerr << "Unable to open file \"" << argv[2] << "\"" << endl;
+        return 1;
+    }
+
+    translator.translate(out, argv[1]);
+    return 0;
+}
@@ -0,0 +1,104 @@
+#include "System.hpp"
+
+#include <iostream>
+#include <chrono>
+#include <climits>
+
+using namespace std::chrono;
+
+// kbasic-bench: time RUN for each program with no window attached.
+//
+//     kbasic-bench [-n runs] program.bas...
+//
+// Prints "<program> <best time in microseconds>" per program; lines
+// starting with # are commentary (dispatch mode, the program's last line
+// of output).
+
+double dpiModifier = 1.0;
+atomic<LoopStatus> loopResult{l_running};
+atomic<ExecutionStatus> executionStatus{ex_done};
+string resourcePath = "";
+
+LoopStatus singleLoop() { return loopResult; }
+
+// Discards program output, keeping only the last line for sanity checks
+class NullConsole : public Console {
+public:
+    string lastLine = "";
+
+    void addText(string s, PrintAppendMode appendMode = pam_none)
+    {
+        m_line += s;
+        if (appendMode == pam_none)
+        {
+            lastLine = m_line;
+            m_line = "";
+        }
+    }
+    void putTextAt(int location, string s, PrintAppendMode appendMode = pam_none)
+    {
+        UNUSED(location)
+        addText(s, appendMode);
+    }
+    void clearText() {}
+    void terminate() {}
+    bool loop() { return true; }
+    float inputNumber(string prompt) { UNUSED(prompt) return 0.0; }
+    string inputString(string prompt) { UNUSED(prompt) return ""; }
+    int lineSize() { return SCREEN_WIDTH; }
+    int lineCount() { return SCREEN_HEIGHT; }
+    string getKey() { return ""; }
+    CursorPos getCursorPos() { return CursorPos(0, 0); }
+    void setCursorPos(const CursorPos &pos) { UNUSED(pos) }
+
+private:
+    string m_line = "";
+};
+
+int main(int argc, char **argv)
+{
+    int runs = 5;
+    int first = 1;
+    if (argc > 2 && string(argv[1]) == "-n")
+    {
+        runs = max(1, atoi(argv[2]));
+        first = 3;
+    }
+    if (first >= argc)
+    {
+        cerr << "Usage: kbasic-bench [-n runs] <program.bas>..." << endl;
+        return 2;
+    }
+
+#ifdef KBASIC_THREADED_DISPATCH
+    cout << "# dispatch: threaded" << endl;
+#else
+    cout << "# dispatch: switch" << endl;
+#endif
+
+    NullConsole console;
+    for (int i = first; i < argc; i++)
+    {
+        string program = argv[i];
+        core->command("load \"" + program + "\"", &console);
+        if (console.lastLine.rfind("Load complete", 0) != 0)
+        {
+            cerr << console.lastLine << endl;
+            return 1;
+        }
+
+        long long best = LLONG_MAX;
+        for (int run = 0; run < runs; run++)
+        {
+            steady_clock::time_point start = steady_clock::now();
+            core->command("run", &console);
+            long long elapsed = duration_cast<microseconds>(steady_clock::now() - start).count();
+            best = min(best, elapsed);
+        }
+
+        cout << "# " << program << ": " << console.lastLine << endl;
+        cout << program << " " << best << endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,119 @@
+#include "FieldWriter.hpp"
+
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// kbasic-fieldwriter-test: ASYNC output when the program gets ahead of the
+// disk.  Exits non-zero on a failure; a writer that hangs is killed by
+// the alarm.  Built with KBASIC_FIELDWRITER_TEST, which lets it hold the
+// I/O threads back.
+
+static const size_t LINE_SIZE = 64 * 1024;
+static const size_t LINES = 16 * 12;        // 12 MB, more blocks than the writer queues
+
+static int failures = 0;
+
+static void check(bool ok, const string &what)
+{
+    if (ok) return;
+    cerr << "FAIL: " << what << endl;
+    failures++;
+}
+
+// Writes LINES lines through an ASYNC writer; true if close() succeeded
+static bool writeLines(const string &filename)
+{
+    string line(LINE_SIZE - 1, 'x');
+    line += "\n";
+
+    FieldWriter writer(filename, 0, true);
+    check(writer.isOpen(), "open " + filename);
+    for (size_t i = 0; i < LINES; i++) check(writer.write(line), "write " + filename);
+    check(writer.flush(), "flush " + filename);
+    return writer.close();
+}
+
+// Nothing reads the pipe until the program has filled every block, so the
+// I/O thread is stuck on its first and the rest have to queue behind it
+static void stalledPipe(const string &dir)
+{
+    string fifo = dir + "/fifo";
+    check(mkfifo(fifo.c_str(), 0600) == 0, "mkfifo");
+
+    // Non-blocking so it doesn't wait for the writer to open the other end
+    int fd = open(fifo.c_str(), O_RDONLY | O_NONBLOCK);
+    check(fd >= 0, "open fifo for reading");
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+
+    size_t received = 0;
+    thread reader([fd, &received]() {
+        this_thread::sleep_for(chrono::milliseconds(200));
+        char buffer[LINE_SIZE];
+        ssize_t n;
+        while ((n = read(fd, buffer, sizeof(buffer))) > 0) received += n;
+    });
+
+    check(writeLines(fifo), "close stalled pipe");
+    reader.join();
+    close(fd);
+    unlink(fifo.c_str());
+
+    check(received == LINES * LINE_SIZE, "bytes through stalled pipe: " + to_string(received));
+}
+
+// Every block is queued before the I/O thread takes the first
+static void heldThread(const string &dir)
+{
+    string filename = dir + "/held.txt";
+
+    FieldWriter::holdIoThreads = true;
+    thread release([]() {
+        this_thread::sleep_for(chrono::milliseconds(200));
+        FieldWriter::holdIoThreads = false;
+    });
+    check(writeLines(filename), "close file written while held");
+    release.join();
+
+    struct stat st;
+    check(stat(filename.c_str(), &st) == 0 && size_t(st.st_size) == LINES * LINE_SIZE,
+        "size of " + filename);
+    unlink(filename.c_str());
+}
+
+static void plainFile(const string &dir)
+{
+    string filename = dir + "/out.txt";
+    check(writeLines(filename), "close file");
+
+    struct stat st;
+    check(stat(filename.c_str(), &st) == 0 && size_t(st.st_size) == LINES * LINE_SIZE,
+        "size of " + filename);
+    unlink(filename.c_str());
+}
+
+int main()
+{
+    alarm(60);
+
+    char dir[] = "/tmp/kbasic-fieldwriter-XXXXXX";
+    if (!mkdtemp(dir))
+    {
+        cerr << "Unable to make a temporary directory" << endl;
+        return 1;
+    }
+
+    heldThread(dir);
+    stalledPipe(dir);
+    plainFile(dir);
+    rmdir(dir);
+
+    if (failures == 0) cout << "FieldWriter: all passed" << endl;
+    return (failures == 0 ? 0 : 1);
+}
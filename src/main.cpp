@@ -11,53 +11,80 @@
 #include <sstream>
 #include <algorithm>
 
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef __APPLE__
 #include <CoreFoundation/CFBundle.h>
+#endif
 #include <SDL2/SDL.h>
 #include <SDL_ttf.h>
 
 #include "main.hpp"
+#include "FontManager.hpp"
 #include "MainWindow.hpp"
+#include "System.hpp"
 
 double dpiModifier = 1.0;
 
-LoopStatus loopResult = l_running;
-ExecutionStatus executionStatus = ex_done;
+atomic<LoopStatus> loopResult{l_running};
+atomic<ExecutionStatus> executionStatus{ex_done};
 
 string resourcePath = "";
 
 void logSDLError(const std::string &msg);
 bool initGraphics();
+LoopStatus uiLoop();
 string findResourcePath();
 
-LoopStatus mainLoop()
+// The window belongs to the main thread, so all the interpreter thread
+// has to do here is notice a break or a quit
+LoopStatus singleLoop()
 {
-    SDL_Event e;
-    while (SDL_PollEvent(&e))
-    {
-        mainWindow->handleEvent(&e);
-        if (loopResult == l_quitting) {
-            break;
-        }
-    }
-    
-    mainWindow->render(false);
-
     return loopResult;
 }
 
-LoopStatus singleLoop()
+// Sleeps in SDL_WaitEventTimeout until there is input, a frame to draw
+// or a cursor blink, so an idle window uses no CPU
+LoopStatus uiLoop()
 {
     SDL_Event e;
-    if (SDL_PollEvent(&e)) mainWindow->handleEvent(&e);
+    if (SDL_WaitEventTimeout(&e, mainWindow->idleTimeout()))
+    {
+        do
+        {
+            mainWindow->handleEvent(&e);
+            if (loopResult == l_quitting) {
+                break;
+            }
+        } while (SDL_PollEvent(&e));
+    }
     
+    mainWindow->update();
     mainWindow->render(false);
 
     return loopResult;
 }
 
+// kbasic [--startup-time] [--profile file] [--trace file]
+//
+// --startup-time prints how long it took from entering main() to the
+// first frame with "Ready" on it.  --profile samples every RUN and writes
+// the samples to file as collapsed stacks when it ends, as PROFILE does;
+// --trace writes a Chrome trace of every RUN the same way, as TRACE does.
 int main(int argc, const char * argv[]) {
-    UNUSED(argc)
-    UNUSED(argv)
+    chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+    bool reportStartup = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--startup-time") == 0) {
+            reportStartup = true;
+        } else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+            core->profileTo(argv[++i]);
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            core->traceTo(argv[++i]);
+        }
+    }
 
     resourcePath = findResourcePath();
 
@@ -67,10 +94,15 @@ int main(int argc, const char * argv[]) {
     
     fontManager->initialize();
     mainWindow = new MainWindow(SCREEN_WIDTH, SCREEN_HEIGHT, 24);
+    mainWindow->render(true);
+    if (reportStartup) {
+        long long elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - startTime).count();
+        cout << "Ready in " << elapsed << " ms" << endl;
+    }
 
     bool quitting = false;
     while (!quitting){
-        quitting = (mainLoop() == l_quitting);
+        quitting = (uiLoop() == l_quitting);
     }
 
     mainWindow->cleanup();
@@ -97,29 +129,22 @@ bool initGraphics() {
     return true;
 }
 
-bool isFloat( string myString ) {
-    std::istringstream iss(myString);
-    float f;
-    iss >> noskipws >> f; // noskipws considers leading whitespace invalid
-    // Check the entire string was consumed and if either failbit or badbit is set
-    return iss.eof() && !iss.fail(); 
-}
-
-bool isInteger(string s)
-{
-    bool result = true;
-    for (char const &c : s)
-    {
-        if (!isdigit(c))
-        {
-            result = false;
-            break;
-        }
-    }
-    return result;
-}
-
+// Inside the application bundle on macOS.  Elsewhere $KBASIC_RESOURCES,
+// then the source tree's resources directory the build was made from,
+// then the directory the executable is in.
 string findResourcePath() {
+#ifndef __APPLE__
+    const char *env = getenv("KBASIC_RESOURCES");
+    if (env) return string(env) + "/";
+#ifdef KBASIC_RESOURCE_DIR
+    return KBASIC_RESOURCE_DIR;
+#else
+    char *base = SDL_GetBasePath();
+    string result = (base ? base : "");
+    SDL_free(base);
+    return result;
+#endif
+#else
     CFBundleRef bundle = CFBundleGetMainBundle();
     CFURLRef resourcesURL = CFBundleCopyBundleURL(bundle);
 	CFStringRef str = CFURLCopyFileSystemPath( resourcesURL, kCFURLPOSIXPathStyle );
@@ -127,12 +152,7 @@ string findResourcePath() {
 	char path[PATH_MAX];
     CFStringGetCString( str, path, FILENAME_MAX, kCFStringEncodingASCII );
     return string(path) + "/Contents/Resources/";
-}
-
-void rtrim(string &s) {
-    s.erase(find_if(s.rbegin(), s.rend(), [](int ch) {
-        return !isspace(ch);
-    }).base(), s.end());
+#endif
 }
 
 
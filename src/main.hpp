@@ -1,8 +1,7 @@
 #ifndef _MAIN_HPP_
 #define _MAIN_HPP_
 
-#include "FontManager.hpp"
-
+#include <atomic>
 #include <string>
 
 using namespace std;
@@ -17,19 +16,32 @@ enum LoopStatus { l_running, l_runningProgram, l_quitting, l_escape, l_end, l_in
 
 enum ExecutionStatus { ex_executing, ex_done };
 
-extern LoopStatus loopResult;
+// Shared by the UI thread and the interpreter thread
+extern atomic<LoopStatus> loopResult;
+
+// How the interpreter changes loopResult: l_quitting is the window's, and
+// a quit asked for while a program is finishing mustn't be lost
+inline void setLoopResult(LoopStatus status)
+{
+    LoopStatus current = loopResult.load();
+    while (current != l_quitting && !loopResult.compare_exchange_weak(current, status)) {}
+}
 extern string resourcePath;
-extern ExecutionStatus executionStatus;
+extern atomic<ExecutionStatus> executionStatus;
 
 #define SCREEN_WIDTH  64
 #define SCREEN_HEIGHT  25
 
-extern LoopStatus mainLoop();
+// Most frames the window draws per second, however often it's asked to
+#define FRAME_RATE  60
+
+// Called by the interpreter between lines
 extern LoopStatus singleLoop();
 
 extern bool isFloat( string myString );
 
 extern bool isInteger(string s);
 extern void rtrim(string &s);
+extern string formatString(string s, string format);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,127 @@
+#include "System.hpp"
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+
+#include <unistd.h>
+
+// kbasic-recordfile-test: FIELD variables through PUT and GET and back,
+// run by the interpreter with no window attached.  Exits non-zero on a
+// failure.
+
+double dpiModifier = 1.0;
+atomic<LoopStatus> loopResult{l_running};
+atomic<ExecutionStatus> executionStatus{ex_done};
+string resourcePath = "";
+
+LoopStatus singleLoop() { return loopResult; }
+
+// Keeps every line of output
+class RecordingConsole : public Console {
+public:
+    vector<string> lines;
+
+    void addText(string s, PrintAppendMode appendMode = pam_none)
+    {
+        m_line += s;
+        if (appendMode == pam_none)
+        {
+            rtrim(m_line);
+            lines.push_back(m_line);
+            m_line = "";
+        }
+    }
+    void putTextAt(int location, string s, PrintAppendMode appendMode = pam_none)
+    {
+        UNUSED(location)
+        addText(s, appendMode);
+    }
+    void clearText() {}
+    void terminate() {}
+    bool loop() { return true; }
+    float inputNumber(string prompt) { UNUSED(prompt) return 0.0; }
+    string inputString(string prompt) { UNUSED(prompt) return ""; }
+    int lineSize() { return SCREEN_WIDTH; }
+    int lineCount() { return SCREEN_HEIGHT; }
+    string getKey() { return ""; }
+    CursorPos getCursorPos() { return CursorPos(0, 0); }
+    void setCursorPos(const CursorPos &pos) { UNUSED(pos) }
+
+private:
+    string m_line = "";
+};
+
+static int failures = 0;
+static string filename;
+
+// Puts q and name$ in record 1 of a file with a 4 and an 8 character
+// field, reads them back and runs the program; its output
+static vector<string> roundTrip(const string &q, const string &name)
+{
+    RecordingConsole console;
+    core->command("new", &console);
+    core->command("10 OPEN \"" + filename + "\" FOR RANDOM AS #1 LEN = 12", &console);
+    core->command("20 FIELD #1, 4 AS Q, 8 AS N$", &console);
+    core->command("30 Q = " + q + " : N$ = \"" + name + "\"", &console);
+    core->command("40 PUT #1, 1", &console);
+    core->command("50 Q = 99 : N$ = \"\"", &console);
+    core->command("60 GET #1, 1", &console);
+    core->command("70 PRINT Q : PRINT N$", &console);
+    core->command("80 CLOSE #1", &console);
+    console.lines.clear();
+    core->command("run", &console);
+    vector<string> result = console.lines;
+
+    // An overflow stops the program before its CLOSE
+    core->command("close #1", &console);
+    unlink(filename.c_str());
+    return result;
+}
+
+static bool contains(const vector<string> &lines, const string &line)
+{
+    return find(lines.begin(), lines.end(), line) != lines.end();
+}
+
+static void check(bool ok, const string &what, const vector<string> &lines)
+{
+    if (ok) return;
+    cerr << "FAIL: " << what << endl;
+    for (const string &line : lines) cerr << "    " << line << endl;
+    failures++;
+}
+
+int main()
+{
+    char path[] = "/tmp/kbasic-recordfile-XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0)
+    {
+        cerr << "Unable to make a temporary file" << endl;
+        return 1;
+    }
+    close(fd);
+    filename = path;
+
+    vector<string> out = roundTrip("1234", "Smith");
+    check(contains(out, "1234") && contains(out, "Smith") && !contains(out, "Field overflow"),
+        "a number as wide as its field", out);
+
+    out = roundTrip("-0.5", "Smith");
+    check(contains(out, "-0.5") && !contains(out, "Field overflow"), "a fraction that fits", out);
+
+    // Text is cut to fit, as it always was
+    out = roundTrip("7", "Wolfeschlegel");
+    check(contains(out, "7") && contains(out, "Wolfesch"), "text cut to its field", out);
+
+    out = roundTrip("123456", "Smith");
+    check(contains(out, "Field overflow") && !contains(out, "1234"), "a number too wide for its field", out);
+
+    out = roundTrip("-0.125", "Smith");
+    check(contains(out, "Field overflow") && !contains(out, "-0.1"), "a fraction too wide for its field", out);
+
+    if (failures == 0) cout << "RecordFile: all passed" << endl;
+    return (failures == 0 ? 0 : 1);
+}
@@ -0,0 +1,182 @@
+#include "main.hpp"
+#include "FontManager.hpp"
+#include "MainWindow.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+
+#include <SDL2/SDL.h>
+#include <SDL_ttf.h>
+
+using namespace std::chrono;
+
+// kbasic-render-bench: time the console window's drawing with no display.
+//
+//     kbasic-render-bench [-n operations] [recording]...
+//
+// Runs on SDL's dummy video driver and software renderer, so it needs
+// neither a screen nor a GPU.  Replays each recording of screen output
+// (made by running kbasic with KBASIC_RECORD=file; the format is in
+// InterpreterThread.hpp), or with none the built-in scroll, status and
+// typing workloads, drawing a frame after every operation.  Prints
+// "<workload> <frames per second> <microseconds per operation>".
+
+double dpiModifier = 1.0;
+atomic<LoopStatus> loopResult{l_running};
+atomic<ExecutionStatus> executionStatus{ex_done};
+string resourcePath = "";
+
+LoopStatus singleLoop() { return loopResult; }
+
+struct Workload {
+    string name;
+    vector<ConsoleCommand> commands;
+};
+
+static ConsoleCommand text(const string &s, PrintAppendMode appendMode)
+{
+    ConsoleCommand command;
+    command.op = co_addText;
+    command.text = s;
+    command.appendMode = appendMode;
+    return command;
+}
+
+// PRINT in a loop: once the screen is full, every line scrolls it
+static Workload scrollWorkload(int operations)
+{
+    Workload w = {"scroll", {}};
+    for (int i = 0; i < operations; i++)
+    {
+        w.commands.push_back(text("LINE " + to_string(i) + " OF STREAMING OUTPUT FROM A BASIC PROGRAM", pam_none));
+    }
+    return w;
+}
+
+// PRINT @ updating a counter in place
+static Workload statusWorkload(int operations)
+{
+    Workload w = {"status", {}};
+    for (int i = 0; i < operations; i++)
+    {
+        ConsoleCommand command = text("COUNT " + to_string(i), pam_append);
+        command.op = co_putTextAt;
+        command.col = SCREEN_WIDTH * (SCREEN_HEIGHT - 1);
+        w.commands.push_back(command);
+    }
+    return w;
+}
+
+// Output a character at a time, as typing or PRINT ...; does
+static Workload typingWorkload(int operations)
+{
+    Workload w = {"typing", {}};
+    for (int i = 0; i < operations; i++)
+    {
+        bool endOfLine = (i % (SCREEN_WIDTH - 4) == SCREEN_WIDTH - 5);
+        w.commands.push_back(text(string(1, char('A' + i % 26)), endOfLine ? pam_none : pam_append));
+    }
+    return w;
+}
+
+static bool loadWorkload(const string &filename, Workload &w)
+{
+    ifstream in(filename);
+    if (!in) return false;
+
+    w.name = filename;
+    string line;
+    while (getline(in, line))
+    {
+        ConsoleCommand command;
+        if (fromRecord(line, command)) w.commands.push_back(command);
+    }
+    return true;
+}
+
+static void replay(const Workload &w)
+{
+    ConsoleCommand clear;
+    clear.op = co_clearText;
+    mainWindow->apply(clear);
+    mainWindow->render(true);
+
+    steady_clock::time_point start = steady_clock::now();
+    for (const ConsoleCommand &command : w.commands)
+    {
+        mainWindow->apply(command);
+        mainWindow->render(true);
+    }
+    double elapsed = duration<double>(steady_clock::now() - start).count();
+
+    size_t count = w.commands.size();
+    double fps = (elapsed > 0 ? count / elapsed : 0);
+    double perOperation = (count > 0 ? elapsed * 1e6 / count : 0);
+    cout << w.name << " " << int(fps) << " " << int(perOperation) << endl;
+}
+
+int main(int argc, char **argv)
+{
+    int operations = 2000;
+    int first = 1;
+    if (argc > 2 && string(argv[1]) == "-n")
+    {
+        operations = max(1, atoi(argv[2]));
+        first = 3;
+    }
+
+    const char *resources = getenv("KBASIC_RESOURCES");
+#ifdef KBASIC_RESOURCE_DIR
+    resourcePath = (resources ? string(resources) + "/" : KBASIC_RESOURCE_DIR);
+#else
+    resourcePath = (resources ? string(resources) + "/" : "");
+#endif
+
+    SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+    SDL_SetHint(SDL_HINT_RENDER_DRIVER, "software");
+    if (SDL_Init(SDL_INIT_VIDEO) != 0 || TTF_Init() != 0)
+    {
+        cerr << "SDL_Init: " << SDL_GetError() << endl;
+        return 1;
+    }
+
+    vector<Workload> workloads;
+    for (int i = first; i < argc; i++)
+    {
+        Workload w;
+        if (!loadWorkload(argv[i], w))
+        {
+            cerr << "Unable to read " << argv[i] << endl;
+            return 1;
+        }
+        workloads.push_back(w);
+    }
+    if (workloads.empty())
+    {
+        workloads.push_back(scrollWorkload(operations));
+        workloads.push_back(statusWorkload(operations));
+        workloads.push_back(typingWorkload(operations));
+    }
+
+    fontManager->initialize();
+    try
+    {
+        mainWindow = new MainWindow(SCREEN_WIDTH, SCREEN_HEIGHT, 24);
+    } catch (const string &msg)
+    {
+        cerr << msg << endl;
+        return 1;
+    } catch (const char *msg)
+    {
+        cerr << msg << endl;
+        return 1;
+    }
+
+    for (const Workload &w : workloads) replay(w);
+
+    mainWindow->cleanup();
+    return 0;
+}